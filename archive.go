@@ -0,0 +1,215 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package main
+
+import (
+	"archive/tar"
+	"archive/zip"
+	"bufio"
+	"errors"
+	"fmt"
+	"io"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"strings"
+	"time"
+)
+
+// archive is a tar or zip archive to which exported files are written as they
+// are produced. The archive is written sequentially, so it can be written to
+// a pipe.
+type archive struct {
+	f     *os.File
+	bw    *bufio.Writer
+	tw    *tar.Writer
+	zw    *zip.Writer
+	names map[string]bool
+	dirs  map[string]map[string]bool
+	err   error
+}
+
+// errArchiveFailed is returned when a file is written to an archive after an
+// earlier write to the archive failed
+var errArchiveFailed = errors.New("archive write failed")
+
+// createArchive creates the archive file path, or writes the archive to
+// standard output if path is "-". A zip archive is written if path ends in
+// ".zip"; otherwise a tar archive is written.
+func createArchive(path string) (*archive, error) {
+	a := archive{
+		names: make(map[string]bool),
+		dirs:  make(map[string]map[string]bool),
+	}
+
+	if path == "-" {
+		a.f = os.Stdout
+	} else {
+		var err error
+		if a.f, err = os.OpenFile(path, os.O_WRONLY|os.O_CREATE|os.O_EXCL, 0666); err != nil {
+			return nil, err
+		}
+	}
+
+	a.bw = bufio.NewWriterSize(a.f, 64*1024)
+	if strings.EqualFold(filepath.Ext(path), ".zip") {
+		a.zw = zip.NewWriter(a.bw)
+	} else {
+		a.tw = tar.NewWriter(a.bw)
+	}
+
+	return &a, nil
+}
+
+// dirNames returns the set of filenames in use in the archive directory dir.
+// The set is shared by all callers, so that conversations that map to the same
+// directory do not choose the same filenames.
+func (a *archive) dirNames(dir string) map[string]bool {
+	names := a.dirs[dir]
+	if names == nil {
+		names = make(map[string]bool)
+		a.dirs[dir] = names
+	}
+	return names
+}
+
+// failed reports whether a write to the archive has failed. If so, the
+// archive cannot be completed and no more files can be added to it.
+func (a *archive) failed() bool {
+	return a.err != nil
+}
+
+// writeFile adds a regular file with the specified name, size, modification
+// time and contents to the archive. If compress is true and the archive is a
+// zip archive, the file is compressed. writeFile returns the number of bytes
+// of the file that were written.
+//
+// If reading from r fails, or r yields fewer than size bytes, a tar entry is
+// padded with zeros to size, so that the archive remains valid, and an error is
+// returned. If writing to the archive fails, the archive is marked as failed
+// and errArchiveFailed is returned for all further files.
+func (a *archive) writeFile(name string, size int64, mtime time.Time, r io.Reader, compress bool) (int64, error) {
+	if a.err != nil {
+		return 0, errArchiveFailed
+	}
+
+	if a.names[name] {
+		return 0, &fs.PathError{Op: "open", Path: name, Err: fs.ErrExist}
+	}
+	a.names[name] = true
+
+	var w io.Writer
+	if a.zw != nil {
+		hdr := zip.FileHeader{
+			Name:     name,
+			Modified: mtime,
+			Method:   zip.Store,
+		}
+		if compress {
+			hdr.Method = zip.Deflate
+		}
+		var err error
+		if w, err = a.zw.CreateHeader(&hdr); err != nil {
+			a.err = err
+			return 0, err
+		}
+	} else {
+		hdr := tar.Header{
+			Typeflag: tar.TypeReg,
+			Name:     name,
+			Size:     size,
+			Mode:     0644,
+			ModTime:  mtime,
+		}
+		if err := a.tw.WriteHeader(&hdr); err != nil {
+			a.err = err
+			return 0, err
+		}
+		w = a.tw
+	}
+
+	er := errReader{r: r}
+	n, err := io.Copy(w, &er)
+	if err != nil && err != er.err && err != tar.ErrWriteTooLong {
+		a.err = err
+		return n, fmt.Errorf("%s: %w", name, err)
+	}
+	if a.tw != nil && n < size {
+		if _, perr := io.CopyN(a.tw, zeroReader{}, size-n); perr != nil {
+			a.err = perr
+			return n, fmt.Errorf("%s: %w", name, perr)
+		}
+	}
+	if err != nil && err != tar.ErrWriteTooLong {
+		return n, fmt.Errorf("%s: %w", name, err)
+	}
+	if err != nil || n != size {
+		return n, fmt.Errorf("%s: file size changed while writing", name)
+	}
+
+	return n, nil
+}
+
+// errReader records the error, other than io.EOF, returned by the underlying
+// reader, so that read errors can be told apart from write errors
+type errReader struct {
+	r   io.Reader
+	err error
+}
+
+func (r *errReader) Read(p []byte) (int, error) {
+	n, err := r.r.Read(p)
+	if err != nil && err != io.EOF {
+		r.err = err
+	}
+	return n, err
+}
+
+type zeroReader struct{}
+
+func (zeroReader) Read(p []byte) (int, error) {
+	for i := range p {
+		p[i] = 0
+	}
+	return len(p), nil
+}
+
+// close completes the archive and closes the archive file. If a write to the
+// archive failed earlier, the archive is closed without being completed and
+// no error is returned; the write error has already been reported.
+func (a *archive) close() error {
+	if a.err != nil {
+		if a.f != os.Stdout {
+			a.f.Close()
+		}
+		return nil
+	}
+
+	var err error
+	if a.zw != nil {
+		err = a.zw.Close()
+	} else {
+		err = a.tw.Close()
+	}
+	if ferr := a.bw.Flush(); err == nil {
+		err = ferr
+	}
+	if a.f != os.Stdout {
+		if cerr := a.f.Close(); err == nil {
+			err = cerr
+		}
+	}
+	return err
+}
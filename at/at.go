@@ -28,6 +28,7 @@ var (
 	ErrInvalidFlag     = errors.New("invalid flag")
 	ErrUnsupportedFlag = errors.New("unsupported flag")
 	ErrMtimeOmitted    = errors.New("omitted modification time")
+	ErrUnsupported     = errors.New("operation not supported")
 )
 
 type Error struct {
@@ -59,6 +60,10 @@ func (d Dir) OpenFile(path string, flag int, perm fs.FileMode) (*os.File, error)
 	return d.openFile(path, flag, perm)
 }
 
+func (d Dir) ReadDirNames() ([]string, error) {
+	return d.readDirNames()
+}
+
 func (d Dir) Mkdir(path string, perm fs.FileMode) error {
 	return d.mkdir(path, perm)
 }
@@ -74,6 +79,25 @@ func (d Dir) Link(srcDir Dir, src, dst string, flag int) error {
 	return d.link(srcDir, src, dst, flag)
 }
 
+// CreateTemp creates an unnamed temporary file in d. The file can be given a
+// name with LinkTemp. If unnamed temporary files are not supported, CreateTemp
+// returns an error that wraps ErrUnsupported. The name argument is only used
+// as the name of the returned os.File.
+func (d Dir) CreateTemp(name string, perm fs.FileMode) (*os.File, error) {
+	return d.createTemp(name, perm)
+}
+
+// LinkTemp links the temporary file f, created with CreateTemp, to dst in d.
+// If f cannot be linked on this system, LinkTemp returns an error that wraps
+// ErrUnsupported.
+func (d Dir) LinkTemp(f *os.File, dst string) error {
+	return d.linkTemp(f, dst)
+}
+
+func (d Dir) Rename(srcDir Dir, src, dst string) error {
+	return d.rename(srcDir, src, dst)
+}
+
 func (d Dir) Symlink(src, dst string) error {
 	return d.symlink(src, dst)
 }
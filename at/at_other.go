@@ -69,6 +69,15 @@ func (d Dir) openFile(path string, flag int, perm fs.FileMode) (*os.File, error)
 	return os.OpenFile(d.join(path), flag, perm)
 }
 
+func (d Dir) readDirNames() ([]string, error) {
+	f, err := os.Open(d.path)
+	if err != nil {
+		return nil, err
+	}
+	defer f.Close()
+	return f.Readdirnames(-1)
+}
+
 func (d Dir) mkdir(path string, perm fs.FileMode) error {
 	return os.Mkdir(d.join(path), perm)
 }
@@ -91,6 +100,10 @@ func (d Dir) link(srcDir Dir, src, dst string, flag int) error {
 	return os.Link(srcDir.join(src), d.join(dst))
 }
 
+func (d Dir) rename(srcDir Dir, src, dst string) error {
+	return os.Rename(srcDir.join(src), d.join(dst))
+}
+
 func (d Dir) symlink(src, dst string) error {
 	return os.Symlink(src, d.join(dst))
 }
@@ -107,6 +120,12 @@ func (d Dir) stat(path string, flag int) (fs.FileInfo, error) {
 }
 
 func futimes(f *os.File, atime, mtime time.Time) error {
+	if mtime == UtimeOmit {
+		return &Error{Op: "futimes", Err: ErrMtimeOmitted}
+	}
+	if atime == UtimeOmit {
+		atime = time.Now()
+	}
 	return os.Chtimes(f.Name(), atime, mtime)
 }
 
@@ -104,6 +104,21 @@ func (d Dir) openFile(path string, flag int, perm fs.FileMode) (*os.File, error)
 	return f, nil
 }
 
+func (d Dir) readDirNames() ([]string, error) {
+	// Open the directory again, so that reading it does not affect the
+	// file offset of d
+	fd, err := unix.Openat(int(d), ".", unix.O_RDONLY|unix.O_DIRECTORY, 0)
+	if err != nil {
+		return nil, &os.PathError{Op: "open", Path: ".", Err: err}
+	}
+	f := os.NewFile(uintptr(fd), ".")
+	if f == nil {
+		panic("os.NewFile returned nil")
+	}
+	defer f.Close()
+	return f.Readdirnames(-1)
+}
+
 func (d Dir) mkdir(path string, perm fs.FileMode) error {
 	if err := unix.Mkdirat(int(d), path, uint32(perm&fs.ModePerm)); err != nil {
 		return &os.PathError{Op: "mkdir", Path: path, Err: err}
@@ -128,6 +143,13 @@ func (d Dir) link(srcDir Dir, src, dst string, flag int) error {
 	return nil
 }
 
+func (d Dir) rename(srcDir Dir, src, dst string) error {
+	if err := unix.Renameat(int(srcDir), src, int(d), dst); err != nil {
+		return &os.LinkError{Op: "rename", Old: src, New: dst, Err: err}
+	}
+	return nil
+}
+
 func (d Dir) symlink(src, dst string) error {
 	if err := unix.Symlinkat(src, int(d), dst); err != nil {
 		return &os.LinkError{Op: "symlink", Old: src, New: dst, Err: err}
@@ -165,15 +187,6 @@ func (d Dir) utimes(path string, atime, mtime time.Time, flag int) error {
 	return nil
 }
 
-func futimes(f *os.File, atime, mtime time.Time) error {
-	atv := unix.NsecToTimeval(atime.UnixNano())
-	mtv := unix.NsecToTimeval(mtime.UnixNano())
-	if err := unix.Futimes(int(f.Fd()), []unix.Timeval{atv, mtv}); err != nil {
-		return &os.PathError{Op: "futimes", Path: f.Name(), Err: err}
-	}
-	return nil
-}
-
 func timeToTimespec(t time.Time) (unix.Timespec, error) {
 	if t == UtimeOmit {
 		return unix.Timespec{0, unixUtimeOmit}, nil
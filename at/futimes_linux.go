@@ -0,0 +1,43 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package at
+
+import (
+	"os"
+	"time"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+// futimes uses utimensat() with a null path, which is how futimens() is
+// implemented on Linux. Unlike unix.Futimes, this does not resolve a path in
+// /proc and it supports UtimeOmit.
+func futimes(f *os.File, atime, mtime time.Time) error {
+	ats, err := timeToTimespec(atime)
+	if err != nil {
+		return &os.PathError{Op: "futimes", Path: f.Name(), Err: err}
+	}
+	mts, err := timeToTimespec(mtime)
+	if err != nil {
+		return &os.PathError{Op: "futimes", Path: f.Name(), Err: err}
+	}
+	ts := [2]unix.Timespec{ats, mts}
+	_, _, errno := unix.Syscall6(unix.SYS_UTIMENSAT, f.Fd(), 0, uintptr(unsafe.Pointer(&ts[0])), 0, 0, 0)
+	if errno != 0 {
+		return &os.PathError{Op: "futimes", Path: f.Name(), Err: errno}
+	}
+	return nil
+}
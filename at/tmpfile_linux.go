@@ -0,0 +1,63 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package at
+
+import (
+	"io/fs"
+	"os"
+	"strconv"
+	"sync/atomic"
+
+	"golang.org/x/sys/unix"
+)
+
+// noProcFd is set once linkTemp has found /proc/self/fd to be unavailable
+var noProcFd atomic.Bool
+
+func (d Dir) createTemp(name string, perm fs.FileMode) (*os.File, error) {
+	if noProcFd.Load() {
+		return nil, &os.PathError{Op: "open", Path: name, Err: ErrUnsupported}
+	}
+	fd, err := unix.Openat(int(d), ".", unix.O_WRONLY|unix.O_TMPFILE|unix.O_CLOEXEC, uint32(perm&fs.ModePerm))
+	if err != nil {
+		// Older kernels fail with EISDIR, file systems without
+		// O_TMPFILE support with EOPNOTSUPP
+		if err == unix.EISDIR || err == unix.EOPNOTSUPP {
+			err = ErrUnsupported
+		}
+		return nil, &os.PathError{Op: "open", Path: name, Err: err}
+	}
+	f := os.NewFile(uintptr(fd), name)
+	if f == nil {
+		panic("os.NewFile returned nil")
+	}
+	return f, nil
+}
+
+func (d Dir) linkTemp(f *os.File, dst string) error {
+	// Linking with AT_EMPTY_PATH requires the CAP_DAC_READ_SEARCH
+	// capability, so link through /proc instead. See open(2).
+	src := "/proc/self/fd/" + strconv.Itoa(int(f.Fd()))
+	if err := unix.Linkat(unix.AT_FDCWD, src, int(d), dst, unix.AT_SYMLINK_FOLLOW); err != nil {
+		// Without /proc (e.g. in a container or chroot) the file
+		// cannot be linked
+		if err == unix.ENOENT {
+			noProcFd.Store(true)
+			err = ErrUnsupported
+		}
+		return &os.LinkError{Op: "link", Old: f.Name(), New: dst, Err: err}
+	}
+	return nil
+}
@@ -0,0 +1,30 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+//go:build !(android || linux)
+
+package at
+
+import (
+	"io/fs"
+	"os"
+)
+
+func (d Dir) createTemp(name string, perm fs.FileMode) (*os.File, error) {
+	return nil, &os.PathError{Op: "open", Path: name, Err: ErrUnsupported}
+}
+
+func (d Dir) linkTemp(f *os.File, dst string) error {
+	return &os.LinkError{Op: "link", Old: f.Name(), New: dst, Err: ErrUnsupported}
+}
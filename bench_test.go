@@ -0,0 +1,320 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package main
+
+import (
+	"flag"
+	"io"
+	"io/fs"
+	"os"
+	"path/filepath"
+	"runtime"
+	"strconv"
+	"sync"
+	"testing"
+	"time"
+
+	"github.com/tbvdm/sigtop/signal"
+	"github.com/tbvdm/sigtop/signal/signaltest"
+)
+
+// The benchmarks share a single synthetic profile. Its size can be changed
+// with the following flags, e.g.:
+//
+//	go test -run '^$' -bench . -count 10 -bench.messages 2000 | tee new.txt
+//	benchstat old.txt new.txt
+var (
+	benchConversations = flag.Int("bench.conversations", 20, "number of conversations in the benchmark profile")
+	benchMessages      = flag.Int("bench.messages", 500, "number of messages per conversation in the benchmark profile")
+)
+
+var benchProfile struct {
+	once sync.Once
+	dir  string
+	err  error
+}
+
+func TestMain(m *testing.M) {
+	flag.Parse()
+	code := m.Run()
+	if benchProfile.dir != "" {
+		os.RemoveAll(benchProfile.dir)
+	}
+	os.Exit(code)
+}
+
+// openBenchProfile generates the benchmark profile, if necessary, and opens
+// it. It returns the profile directory, the context and the total number of
+// messages.
+func openBenchProfile(b *testing.B) (string, *signal.Context, int) {
+	b.Helper()
+
+	benchProfile.once.Do(func() {
+		benchProfile.dir, benchProfile.err = os.MkdirTemp("", "sigtop-bench-")
+		if benchProfile.err != nil {
+			return
+		}
+		cfg := signaltest.DefaultConfig()
+		cfg.Conversations = *benchConversations
+		cfg.Messages = *benchMessages
+		benchProfile.err = signaltest.Generate(benchProfile.dir, cfg)
+	})
+	if benchProfile.err != nil {
+		b.Fatal(benchProfile.err)
+	}
+
+	ctx, err := signal.Open(benchProfile.dir)
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.Cleanup(ctx.Close)
+
+	return benchProfile.dir, ctx, *benchConversations * *benchMessages
+}
+
+// runBenchmark calls fn b.N times, each time with a new empty directory. Only
+// the time spent in fn is measured. The size of the files that fn creates is
+// reported as the number of bytes processed per operation. If msgs is greater
+// than 0, the number of messages processed per second is reported as well.
+//
+// The growth of the Go heap during each call is reported as heap-B/op. The heap
+// is collected before each call, so that the metric does not depend on the
+// benchmarks that ran earlier. Memory allocated by SQLite is not included.
+func runBenchmark(b *testing.B, msgs int, fn func(dir string) error) {
+	b.Helper()
+	b.ReportAllocs()
+
+	base := b.TempDir()
+	var elapsed time.Duration
+	var heap uint64
+	var ms runtime.MemStats
+
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		b.StopTimer()
+		dir := filepath.Join(base, strconv.Itoa(i))
+		if err := os.Mkdir(dir, 0777); err != nil {
+			b.Fatal(err)
+		}
+		runtime.GC()
+		runtime.ReadMemStats(&ms)
+		before := ms.HeapInuse
+		b.StartTimer()
+
+		start := time.Now()
+		err := fn(dir)
+		elapsed += time.Since(start)
+
+		b.StopTimer()
+		if err != nil {
+			b.Fatal(err)
+		}
+		runtime.ReadMemStats(&ms)
+		if ms.HeapInuse > before {
+			heap += ms.HeapInuse - before
+		}
+		if i == 0 {
+			if n := treeSize(b, dir); n > 0 {
+				b.SetBytes(n)
+			}
+		}
+		if err := os.RemoveAll(dir); err != nil {
+			b.Fatal(err)
+		}
+		b.StartTimer()
+	}
+	b.StopTimer()
+
+	if msgs > 0 && elapsed > 0 {
+		b.ReportMetric(float64(msgs)*float64(b.N)/elapsed.Seconds(), "msgs/s")
+	}
+	b.ReportMetric(float64(heap)/float64(b.N), "heap-B/op")
+}
+
+// treeSize returns the total size of the files in dir. Symbolic links are
+// followed.
+func treeSize(b *testing.B, dir string) int64 {
+	b.Helper()
+	var size int64
+	err := filepath.WalkDir(dir, func(path string, de fs.DirEntry, err error) error {
+		if err != nil || de.IsDir() {
+			return err
+		}
+		fi, err := os.Stat(path)
+		if err != nil {
+			return err
+		}
+		size += fi.Size()
+		return nil
+	})
+	if err != nil {
+		b.Fatal(err)
+	}
+	return size
+}
+
+// errFailed is returned by benchmarked functions that report errors by
+// logging them
+type errFailed string
+
+func (e errFailed) Error() string {
+	return string(e) + " failed"
+}
+
+func BenchmarkExportMessages(b *testing.B) {
+	formats := []struct {
+		name   string
+		format formatMode
+	}{
+		{"json", formatJSON},
+		{"text", formatText},
+		{"text-short", formatTextShort},
+	}
+
+	for _, f := range formats {
+		b.Run(f.name, func(b *testing.B) {
+			_, ctx, msgs := openBenchProfile(b)
+			mode := msgMode{format: f.format}
+			runBenchmark(b, msgs, func(dir string) error {
+				if !exportMessages(ctx, dir, nil, mode, nil, signal.Interval{}) {
+					return errFailed("exportMessages")
+				}
+				return nil
+			})
+		})
+	}
+}
+
+// BenchmarkExportMessagesCacheSize compares the SQLite default page cache with
+// the automatically sized one
+func BenchmarkExportMessagesCacheSize(b *testing.B) {
+	sizes := []struct {
+		name string
+		size int64
+	}{
+		{"default", 0},
+		{"auto", -1},
+	}
+
+	defer signal.SetCacheSize(-1)
+	for _, s := range sizes {
+		b.Run(s.name, func(b *testing.B) {
+			signal.SetCacheSize(s.size)
+			_, ctx, msgs := openBenchProfile(b)
+			mode := msgMode{format: formatJSON}
+			runBenchmark(b, msgs, func(dir string) error {
+				if !exportMessages(ctx, dir, nil, mode, nil, signal.Interval{}) {
+					return errFailed("exportMessages")
+				}
+				return nil
+			})
+		})
+	}
+}
+
+var benchExportModes = []struct {
+	name string
+	mode exportMode
+}{
+	{"copy", exportCopy},
+	{"link", exportLink},
+	{"symlink", exportSymlink},
+}
+
+func BenchmarkExportAttachments(b *testing.B) {
+	for _, m := range benchExportModes {
+		b.Run(m.name, func(b *testing.B) {
+			_, ctx, msgs := openBenchProfile(b)
+			mode := attMode{export: m.mode}
+			runBenchmark(b, msgs, func(dir string) error {
+				if !exportAttachments(ctx, dir, nil, mode, nil, signal.Interval{}) {
+					return errFailed("exportAttachments")
+				}
+				return nil
+			})
+		})
+	}
+}
+
+func BenchmarkExportAvatars(b *testing.B) {
+	for _, m := range benchExportModes {
+		b.Run(m.name, func(b *testing.B) {
+			_, ctx, _ := openBenchProfile(b)
+			runBenchmark(b, 0, func(dir string) error {
+				if !exportAvatars(ctx, dir, m.mode, nil) {
+					return errFailed("exportAvatars")
+				}
+				return nil
+			})
+		})
+	}
+}
+
+func BenchmarkWriteDatabase(b *testing.B) {
+	_, ctx, msgs := openBenchProfile(b)
+	runBenchmark(b, msgs, func(dir string) error {
+		return ctx.WriteDatabase(filepath.Join(dir, "db.sqlite"))
+	})
+}
+
+func BenchmarkQueryDatabase(b *testing.B) {
+	formats := []struct {
+		name   string
+		format queryFormat
+	}{
+		{"text", queryFormatText},
+		{"csv", queryFormatCSV},
+		{"tsv", queryFormatTSV},
+		{"ndjson", queryFormatNDJSON},
+	}
+
+	for _, f := range formats {
+		b.Run(f.name, func(b *testing.B) {
+			profileDir, ctx, msgs := openBenchProfile(b)
+			setDatabaseBytes(b, profileDir)
+			runBenchmark(b, msgs, func(string) error {
+				qw := newQueryWriter(io.Discard, f.format)
+				err := ctx.QueryDatabase("SELECT * FROM messages", qw.floatText(), qw.writeRow)
+				if ferr := qw.flush(); err == nil {
+					err = ferr
+				}
+				return err
+			})
+		})
+	}
+}
+
+func BenchmarkCheckDatabase(b *testing.B) {
+	profileDir, ctx, _ := openBenchProfile(b)
+	setDatabaseBytes(b, profileDir)
+	runBenchmark(b, 0, func(string) error {
+		results, err := ctx.CheckDatabase()
+		if err == nil && len(results) > 0 {
+			err = errFailed("CheckDatabase")
+		}
+		return err
+	})
+}
+
+// setDatabaseBytes reports the size of the database as the number of bytes
+// processed per operation
+func setDatabaseBytes(b *testing.B, profileDir string) {
+	b.Helper()
+	fi, err := os.Stat(filepath.Join(profileDir, signal.DatabaseFile))
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.SetBytes(fi.Size())
+}
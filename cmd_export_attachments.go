@@ -23,6 +23,7 @@ import (
 	"log"
 	"os"
 	"path/filepath"
+	"sort"
 	"strings"
 	"time"
 
@@ -30,6 +31,7 @@ import (
 	"github.com/tbvdm/sigtop/at"
 	"github.com/tbvdm/sigtop/getopt"
 	"github.com/tbvdm/sigtop/signal"
+	"github.com/tbvdm/sigtop/stats"
 )
 
 const incrementalFile = ".incremental"
@@ -54,12 +56,16 @@ type attMode struct {
 	export      exportMode
 	mtime       mtimeMode
 	incremental bool
+	diskOrder   bool
+	progress    bool
+	order       convOrder
+	stats       *stats.Stats
 }
 
 var cmdExportAttachmentsEntry = cmdEntry{
 	name:  "export-attachments",
 	alias: "att",
-	usage: "[-iLlMm] [-c conversation] [-d signal-directory] [-s interval] [directory]",
+	usage: "[-iLlMmpv] [-a archive] [-c conversation] [-d signal-directory] [-o order] [-S stats-file] [-s interval] [directory]",
 	exec:  cmdExportAttachments,
 }
 
@@ -68,13 +74,17 @@ func cmdExportAttachments(args []string) cmdStatus {
 		export:      exportCopy,
 		mtime:       mtimeNone,
 		incremental: false,
+		diskOrder:   false,
 	}
 
-	getopt.ParseArgs("c:d:iLlMms:", args)
-	var dArg, sArg getopt.Arg
+	getopt.ParseArgs("a:c:d:iLlMmpo:S:s:v", args)
+	var aArg, dArg, SArg, sArg getopt.Arg
 	var selectors []string
+	verbose := false
 	for getopt.Next() {
 		switch getopt.Option() {
+		case 'a':
+			aArg = getopt.OptionArg()
 		case 'c':
 			selectors = append(selectors, getopt.OptionArg().String())
 		case 'd':
@@ -89,8 +99,20 @@ func cmdExportAttachments(args []string) cmdStatus {
 			mode.mtime = mtimeSent
 		case 'm':
 			mode.mtime = mtimeRecv
+		case 'p':
+			mode.diskOrder = true
+		case 'o':
+			var err error
+			if mode.order, err = parseConversationOrder(getopt.OptionArg().String()); err != nil {
+				log.Fatal(err)
+			}
+		case 'S':
+			SArg = getopt.OptionArg()
 		case 's':
 			sArg = getopt.OptionArg()
+		case 'v':
+			verbose = true
+			mode.progress = true
 		}
 	}
 
@@ -100,10 +122,17 @@ func cmdExportAttachments(args []string) cmdStatus {
 
 	args = getopt.Args()
 	var exportDir string
-	switch len(args) {
-	case 0:
+	switch {
+	case aArg.Set():
+		if len(args) != 0 {
+			return cmdUsage
+		}
+		if mode.incremental || mode.export != exportCopy {
+			log.Fatal("cannot use -a with -i, -L or -l")
+		}
+	case len(args) == 0:
 		exportDir = "."
-	case 1:
+	case len(args) == 1:
 		exportDir = args[0]
 		if err := os.Mkdir(exportDir, 0777); err != nil && !errors.Is(err, fs.ErrExist) {
 			log.Fatal(err)
@@ -136,7 +165,11 @@ func cmdExportAttachments(args []string) cmdStatus {
 		log.Fatal(err)
 	}
 
-	if err := openbsd.Unveil(exportDir, "rwc"); err != nil {
+	if err := unveilExportPath(exportDir, aArg); err != nil {
+		log.Fatal(err)
+	}
+
+	if err := unveilStatsFile(SArg); err != nil {
 		log.Fatal(err)
 	}
 
@@ -159,26 +192,77 @@ func cmdExportAttachments(args []string) cmdStatus {
 		}
 	}
 
-	ctx, err := signal.Open(signalDir)
+	var arc *archive
+	if aArg.Set() {
+		var err error
+		if arc, err = createArchive(aArg.String()); err != nil {
+			log.Fatal(err)
+		}
+	}
+
+	var st *stats.Stats
+	var statsFile *os.File
+	if verbose || SArg.Set() {
+		st = stats.New()
+	}
+	if SArg.Set() {
+		var err error
+		if statsFile, err = os.Create(SArg.String()); err != nil {
+			log.Fatal(err)
+		}
+	}
+	mode.stats = st
+
+	ctx, err := openSignalDir(signalDir)
 	if err != nil {
 		log.Fatal(err)
 	}
 	defer ctx.Close()
+	ctx.SetStats(st)
+
+	// Export a consistent view of the database
+	if err := ctx.BeginRead(); err != nil {
+		log.Print(err)
+		return cmdError
+	}
 
-	if !exportAttachments(ctx, exportDir, mode, selectors, ival) {
+	// A full export reads most of the database
+	if selectors == nil {
+		ctx.ReadAhead()
+	}
+
+	ok := exportAttachments(ctx, exportDir, arc, mode, selectors, ival)
+
+	if arc != nil {
+		if err := arc.close(); err != nil {
+			log.Print(err)
+			return cmdError
+		}
+	}
+
+	if !writeStats(st, verbose, statsFile) {
+		return cmdError
+	}
+
+	if !ok {
 		return cmdError
 	}
 
 	return cmdOK
 }
 
-func exportAttachments(ctx *signal.Context, dir string, mode attMode, selectors []string, ival signal.Interval) bool {
-	d, err := at.Open(dir)
-	if err != nil {
-		log.Print(err)
-		return false
+// exportAttachments exports attachments to the directory dir or, if arc is not
+// nil, to the archive arc
+func exportAttachments(ctx *signal.Context, dir string, arc *archive, mode attMode, selectors []string, ival signal.Interval) bool {
+	d := at.InvalidDir
+	if arc == nil {
+		var err error
+		if d, err = at.Open(dir); err != nil {
+			log.Print(err)
+			return false
+		}
+		defer d.Close()
 	}
-	defer d.Close()
 
 	var exported map[string]bool
 	if mode.incremental {
@@ -189,18 +273,33 @@ func exportAttachments(ctx *signal.Context, dir string, mode attMode, selectors
 		}
 	}
 
-	convs, err := selectConversations(ctx, selectors)
+	convs, sums, err := selectNonEmptyConversations(ctx, selectors, ival)
 	if err != nil {
 		log.Print(err)
 		return false
 	}
 
+	sortConversations(convs, mode.order, sums)
+
+	var prog *progress
+	if mode.progress {
+		total := 0
+		for _, conv := range convs {
+			total += sums[conv.ID].Messages
+		}
+		prog = newProgress(total)
+	}
+
 	ret := true
 	for _, conv := range convs {
 		var ok bool
-		if ok, exported = exportConversationAttachments(ctx, d, &conv, mode, exported, ival); !ok {
+		if ok, exported = exportConversationAttachments(ctx, d, arc, &conv, mode, exported, ival); !ok {
 			ret = false
+			if arc != nil && arc.failed() {
+				break
+			}
 		}
+		prog.add(sums[conv.ID].Messages)
 	}
 
 	if mode.incremental {
@@ -213,7 +312,7 @@ func exportAttachments(ctx *signal.Context, dir string, mode attMode, selectors
 	return ret
 }
 
-func exportConversationAttachments(ctx *signal.Context, d at.Dir, conv *signal.Conversation, mode attMode, exported map[string]bool, ival signal.Interval) (bool, map[string]bool) {
+func exportConversationAttachments(ctx *signal.Context, d at.Dir, arc *archive, conv *signal.Conversation, mode attMode, exported map[string]bool, ival signal.Interval) (bool, map[string]bool) {
 	atts, err := ctx.ConversationAttachments(conv, ival)
 	if err != nil {
 		log.Print(err)
@@ -224,19 +323,32 @@ func exportConversationAttachments(ctx *signal.Context, d at.Dir, conv *signal.C
 		return true, exported
 	}
 
-	cd, err := conversationDir(d, conv)
-	if err != nil {
-		log.Print(err)
-		return false, exported
+	var cd *convDir
+	var names map[string]bool
+	var dir string
+	if arc == nil {
+		if cd, err = conversationDir(d, conv); err != nil {
+			log.Print(err)
+			return false, exported
+		}
+		defer cd.Close()
+		names = cd.names
+	} else {
+		dir = recipientFilename(conv.Recipient, "")
+		names = arc.dirNames(dir)
 	}
 
+	// Choose the names of the exported files in message order, so that
+	// the names do not depend on the order in which the files are copied
 	ret := true
-	for _, att := range atts {
+	var jobs []attJob
+	for i := range atts {
+		att := &atts[i]
 		id := filepath.Base(att.Path)
 		if mode.incremental && exported[id] {
 			continue
 		}
-		src := ctx.AttachmentPath(&att)
+		src := ctx.AttachmentPath(att)
 		if src == "" {
 			var msg string
 			if att.Pending {
@@ -248,61 +360,165 @@ func exportConversationAttachments(ctx *signal.Context, d at.Dir, conv *signal.C
 			log.Printf("%s (conversation: %q, sent: %s)", msg, conv.Recipient.DisplayName(), time.UnixMilli(att.TimeSent).Format("2006-01-02 15:04:05"))
 			continue
 		}
-		if _, err := os.Stat(src); err != nil {
+		if err := ctx.CheckAttachmentFile(att); err != nil {
 			log.Print(err)
 			ret = false
 			continue
 		}
-		dst, err := attachmentFilename(cd, &att)
+		dst, err := attachmentFilename(names, att)
 		if err != nil {
 			log.Print(err)
 			ret = false
 			continue
 		}
-		switch mode.export {
-		case exportCopy:
-			if err := copyAttachment(src, cd, dst); err != nil {
-				log.Print(err)
-				ret = false
-				continue
-			}
-			if err := setAttachmentModTime(cd, dst, &att, mode.mtime); err != nil {
-				log.Print(err)
-				ret = false
-			}
-		case exportLink:
-			if err := cd.Link(at.CurrentDir, src, dst, 0); err != nil {
-				log.Print(err)
-				ret = false
-			}
-		case exportSymlink:
-			if err := cd.Symlink(src, dst); err != nil {
+		jobs = append(jobs, attJob{att: att, id: id, src: src, dst: dst})
+	}
+
+	if mode.diskOrder && (arc != nil || mode.export == exportCopy) {
+		sortJobsByDiskLocation(jobs)
+	}
+
+	if arc != nil {
+		for _, job := range jobs {
+			prev := mode.stats.Enter(stats.Copy)
+			n, err := archiveAttachment(arc, dir+"/"+job.dst, job.src, job.att, mode)
+			mode.stats.Leave(prev)
+			mode.stats.AddBytes(n)
+			if err != nil {
 				log.Print(err)
 				ret = false
+				if arc.failed() {
+					break
+				}
 				continue
 			}
-			if err := setAttachmentModTime(cd, dst, &att, mode.mtime); err != nil {
+			mode.stats.AddAttachments(1)
+		}
+		return ret, exported
+	}
+
+	for _, job := range jobs {
+		prev := mode.stats.Enter(stats.Copy)
+		dst, n, err := createAttachment(job.src, cd, job.dst, job.att, mode)
+		mode.stats.Leave(prev)
+		mode.stats.AddBytes(n)
+		if err != nil {
+			log.Print(err)
+			ret = false
+			continue
+		}
+		if mode.export == exportSymlink {
+			if err := setAttachmentModTime(cd.Dir, dst, job.att, mode.mtime); err != nil {
 				log.Print(err)
 				ret = false
 			}
 		}
 		if mode.incremental {
-			exported[id] = true
+			exported[job.id] = true
 		}
+		mode.stats.AddAttachments(1)
 	}
 
 	return ret, exported
 }
 
-func conversationDir(d at.Dir, conv *signal.Conversation) (at.Dir, error) {
+type attJob struct {
+	att *signal.Attachment
+	id  string
+	src string
+	dst string
+	loc diskLocation
+}
+
+// sortJobsByDiskLocation sorts jobs by the location of their source files on
+// disk, to reduce seeking when copying them from a rotating disk or with a cold
+// cache. Files are sorted by the physical offset of their first extent, if
+// known for all files, or else by inode number.
+func sortJobsByDiskLocation(jobs []attJob) {
+	haveOffsets := true
+	for i := range jobs {
+		f, err := os.Open(jobs[i].src)
+		if err != nil {
+			// Let createAttachment report the error
+			continue
+		}
+		jobs[i].loc = fileDiskLocation(f)
+		f.Close()
+		if !jobs[i].loc.hasOffset {
+			haveOffsets = false
+		}
+	}
+
+	sort.SliceStable(jobs, func(i, j int) bool {
+		if haveOffsets {
+			return jobs[i].loc.offset < jobs[j].loc.offset
+		}
+		return jobs[i].loc.inode < jobs[j].loc.inode
+	})
+}
+
+// convDir is a conversation directory. The names of the files in the directory
+// are read once, when the directory is opened, and are kept up to date as
+// files are created. This allows unique filenames to be generated without
+// probing the file system.
+type convDir struct {
+	at.Dir
+	names map[string]bool
+}
+
+func conversationDir(d at.Dir, conv *signal.Conversation) (*convDir, error) {
 	name := recipientFilename(conv.Recipient, "")
 	if err := d.Mkdir(name, 0777); err != nil && !errors.Is(err, fs.ErrExist) {
-		return at.InvalidDir, err
+		return nil, err
+	}
+
+	cd, err := d.OpenDir(name)
+	if err != nil {
+		return nil, err
+	}
+
+	names, err := cd.ReadDirNames()
+	if err != nil {
+		cd.Close()
+		return nil, err
+	}
+
+	nameSet := make(map[string]bool, len(names))
+	for _, n := range names {
+		nameSet[n] = true
+	}
+
+	return &convDir{Dir: cd, names: nameSet}, nil
+}
+
+// createAttachment copies or links the attachment file src to dst in the
+// conversation directory cd. If dst turns out to exist already, another name
+// is chosen. createAttachment returns the name of the new file and the number
+// of bytes copied, if any.
+func createAttachment(src string, cd *convDir, dst string, att *signal.Attachment, mode attMode) (string, int64, error) {
+	for {
+		var n int64
+		var err error
+		switch mode.export {
+		case exportCopy:
+			n, err = copyAttachment(src, cd.Dir, dst, attachmentModTime(att, mode.mtime), mode.diskOrder)
+		case exportLink:
+			err = cd.Link(at.CurrentDir, src, dst, 0)
+		case exportSymlink:
+			err = cd.Symlink(src, dst)
+		}
+		// The name may exist if it was created after the directory
+		// was read, or if the file system is case-insensitive
+		if !errors.Is(err, fs.ErrExist) {
+			return dst, n, err
+		}
+		if dst, err = attachmentFilename(cd.names, att); err != nil {
+			return "", 0, err
+		}
 	}
-	return d.OpenDir(name)
 }
 
-func attachmentFilename(d at.Dir, att *signal.Attachment) (string, error) {
+func attachmentFilename(names map[string]bool, att *signal.Attachment) (string, error) {
 	var name string
 	if att.FileName != "" {
 		name = time.UnixMilli(att.TimeSent).Format("2006-01-02-15-04-05") + "-" + sanitiseFilename(att.FileName)
@@ -314,12 +530,15 @@ func attachmentFilename(d at.Dir, att *signal.Attachment) (string, error) {
 		name = time.UnixMilli(att.TimeSent).Format("2006-01-02-15-04-05") + "-attachment" + ext
 	}
 
-	return uniqueFilename(d, name)
+	return uniqueFilename(names, name)
 }
 
-func uniqueFilename(d at.Dir, path string) (string, error) {
-	if ok, err := fileExists(d, path); !ok {
-		return path, err
+// uniqueFilename returns a name, based on path, that is not in names, and adds
+// it to names.
+func uniqueFilename(names map[string]bool, path string) (string, error) {
+	if !names[path] {
+		names[path] = true
+		return path, nil
 	}
 
 	suffix := filepath.Ext(path)
@@ -327,55 +546,186 @@ func uniqueFilename(d at.Dir, path string) (string, error) {
 
 	for i := 2; i > 0; i++ {
 		newPath := fmt.Sprintf("%s-%d%s", prefix, i, suffix)
-		if ok, err := fileExists(d, newPath); !ok {
-			return newPath, err
+		if !names[newPath] {
+			names[newPath] = true
+			return newPath, nil
 		}
 	}
 
 	return "", fmt.Errorf("%s: cannot generate unique name", path)
 }
 
-func fileExists(d at.Dir, path string) (bool, error) {
-	if _, err := d.Stat(path, at.SymlinkNoFollow); err != nil {
-		if !errors.Is(err, fs.ErrNotExist) {
-			return false, err
+// copyAttachment copies the attachment file src to dst in d and sets the
+// modification time of dst to mtime, unless mtime is at.UtimeOmit. The copy is
+// written to a temporary file first, so that dst only becomes visible once it
+// is complete. If readAhead is true, the kernel is advised to read src in its
+// entirety. copyAttachment returns the number of bytes copied if dst was
+// created.
+func copyAttachment(src string, d at.Dir, dst string, mtime time.Time, readAhead bool) (int64, error) {
+	rf, err := os.Open(src)
+	if err != nil {
+		return 0, err
+	}
+	defer rf.Close()
+
+	if readAhead {
+		adviseSequential(rf)
+	}
+
+	wf, tmp, err := createTempFile(d, dst)
+	if err != nil {
+		return 0, err
+	}
+
+	n, err := writeTempFile(wf, rf, mtime)
+	if err != nil {
+		wf.Close()
+		removeTempFile(d, tmp)
+		return 0, err
+	}
+
+	if tmp == "" {
+		err = d.LinkTemp(wf, dst)
+		if cerr := wf.Close(); err == nil {
+			err = cerr
+		}
+		if !errors.Is(err, at.ErrUnsupported) {
+			if err != nil {
+				return 0, err
+			}
+			return n, nil
+		}
+
+		// The unnamed file cannot be linked after all, so copy src to
+		// a named file instead
+		if _, err := rf.Seek(0, io.SeekStart); err != nil {
+			return 0, err
+		}
+		if wf, tmp, err = createNamedTempFile(d, dst); err != nil {
+			return 0, err
+		}
+		if n, err = writeTempFile(wf, rf, mtime); err != nil {
+			wf.Close()
+			removeTempFile(d, tmp)
+			return 0, err
 		}
-		return false, nil
 	}
-	return true, nil
+
+	if err := wf.Close(); err != nil {
+		removeTempFile(d, tmp)
+		return 0, err
+	}
+	err = renameTempFile(d, tmp, dst)
+	removeTempFile(d, tmp)
+	if err != nil {
+		return 0, err
+	}
+	return n, nil
 }
 
-func copyAttachment(src string, d at.Dir, dst string) error {
-	rf, err := os.Open(src)
+// createTempFile creates a temporary file for dst in d. If possible, the file
+// is unnamed and tmp is empty. Otherwise, tmp is the name of the file.
+func createTempFile(d at.Dir, dst string) (f *os.File, tmp string, err error) {
+	f, err = d.CreateTemp(dst, 0666)
+	if err == nil || !errors.Is(err, at.ErrUnsupported) {
+		return f, "", err
+	}
+	return createNamedTempFile(d, dst)
+}
+
+// createNamedTempFile creates a temporary file for dst in d and returns the
+// file and its name
+func createNamedTempFile(d at.Dir, dst string) (f *os.File, tmp string, err error) {
+	// Attachment filenames never start with a dot, so this cannot clash
+	// with an exported attachment. Truncate any leftover from an earlier,
+	// interrupted run.
+	tmp = "." + dst + ".tmp"
+	f, err = d.OpenFile(tmp, os.O_WRONLY|os.O_CREATE|os.O_TRUNC, 0666)
+	return f, tmp, err
+}
+
+func writeTempFile(wf *os.File, rf io.Reader, mtime time.Time) (int64, error) {
+	n, err := io.Copy(wf, rf)
 	if err != nil {
+		return 0, fmt.Errorf("copy %s: %w", wf.Name(), err)
+	}
+	if mtime != at.UtimeOmit {
+		if err := at.Futimes(wf, at.UtimeOmit, mtime); err != nil {
+			return 0, err
+		}
+	}
+	return n, nil
+}
+
+// renameTempFile gives the temporary file tmp the name dst, without
+// overwriting an existing dst. It links rather than renames, because renaming
+// would silently replace dst. If hard links are not supported, it falls back
+// to renaming.
+func renameTempFile(d at.Dir, tmp, dst string) error {
+	err := d.Link(d, tmp, dst, 0)
+	if err == nil || errors.Is(err, fs.ErrExist) {
 		return err
 	}
-	defer rf.Close()
+	if _, serr := d.Stat(dst, at.SymlinkNoFollow); !errors.Is(serr, fs.ErrNotExist) {
+		return err
+	}
+	return d.Rename(d, tmp, dst)
+}
 
-	wf, err := d.OpenFile(dst, os.O_WRONLY|os.O_CREATE|os.O_EXCL, 0666)
+func removeTempFile(d at.Dir, tmp string) {
+	if tmp != "" {
+		// The file may have been renamed already
+		if err := d.Unlink(tmp, 0); err != nil && !errors.Is(err, fs.ErrNotExist) {
+			log.Print(err)
+		}
+	}
+}
+
+// archiveAttachment adds the attachment file src to the archive arc. The data
+// is read directly from src, without an intermediate copy. archiveAttachment
+// returns the number of bytes written to the archive.
+func archiveAttachment(arc *archive, name, src string, att *signal.Attachment, mode attMode) (int64, error) {
+	f, err := os.Open(src)
 	if err != nil {
-		return err
+		return 0, err
 	}
+	defer f.Close()
 
-	if _, err := io.Copy(wf, rf); err != nil {
-		wf.Close()
-		return fmt.Errorf("copy %s: %w", dst, err)
+	fi, err := f.Stat()
+	if err != nil {
+		return 0, err
+	}
+
+	if mode.diskOrder {
+		adviseSequential(f)
+	}
+
+	mtime := attachmentModTime(att, mode.mtime)
+	if mtime == at.UtimeOmit {
+		mtime = time.Now()
 	}
 
-	return wf.Close()
+	// Attachments are mostly media files, which do not compress well
+	return arc.writeFile(name, fi.Size(), mtime, f, false)
 }
 
-func setAttachmentModTime(d at.Dir, path string, att *signal.Attachment, mode mtimeMode) error {
-	var mtime int64
+func attachmentModTime(att *signal.Attachment, mode mtimeMode) time.Time {
 	switch mode {
 	case mtimeSent:
-		mtime = att.TimeSent
+		return time.UnixMilli(att.TimeSent)
 	case mtimeRecv:
-		mtime = att.TimeRecv
+		return time.UnixMilli(att.TimeRecv)
 	default:
+		return at.UtimeOmit
+	}
+}
+
+func setAttachmentModTime(d at.Dir, path string, att *signal.Attachment, mode mtimeMode) error {
+	mtime := attachmentModTime(att, mode)
+	if mtime == at.UtimeOmit {
 		return nil
 	}
-	return d.Utimes(path, at.UtimeOmit, time.UnixMilli(mtime), at.SymlinkNoFollow)
+	return d.Utimes(path, at.UtimeOmit, mtime, at.SymlinkNoFollow)
 }
 
 func readIncrementalFile(d at.Dir) (map[string]bool, error) {
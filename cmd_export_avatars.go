@@ -99,12 +99,18 @@ func cmdExportAvatars(args []string) cmdStatus {
 		log.Fatal(err)
 	}
 
-	ctx, err := signal.Open(signalDir)
+	ctx, err := openSignalDir(signalDir)
 	if err != nil {
 		log.Fatal(err)
 	}
 	defer ctx.Close()
 
+	// Export a consistent view of the database
+	if err := ctx.BeginRead(); err != nil {
+		log.Print(err)
+		return cmdError
+	}
+
 	if !exportAvatars(ctx, exportDir, mode, selectors) {
 		return cmdError
 	}
@@ -90,12 +90,13 @@ func cmdExportDatabase(args []string) cmdStatus {
 	}
 	f.Close()
 
-	ctx, err := signal.Open(signalDir)
+	ctx, err := openSignalDir(signalDir)
 	if err != nil {
 		log.Fatal(err)
 	}
 	defer ctx.Close()
 
+	ctx.ReadAhead()
 	if err = ctx.WriteDatabase(dbFile); err != nil {
 		log.Print(err)
 		return cmdError
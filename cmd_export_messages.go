@@ -15,16 +15,22 @@
 package main
 
 import (
+	"bytes"
+	"compress/flate"
 	"errors"
+	"io"
 	"io/fs"
 	"log"
 	"os"
+	"time"
 
 	"github.com/tbvdm/go-openbsd"
 	"github.com/tbvdm/sigtop/at"
 	"github.com/tbvdm/sigtop/errio"
 	"github.com/tbvdm/sigtop/getopt"
+	"github.com/tbvdm/sigtop/pgzip"
 	"github.com/tbvdm/sigtop/signal"
+	"github.com/tbvdm/sigtop/stats"
 )
 
 type formatMode int
@@ -38,12 +44,17 @@ const (
 type msgMode struct {
 	format      formatMode
 	incremental bool
+	compress    bool
+	level       int
+	progress    bool
+	order       convOrder
+	stats       *stats.Stats
 }
 
 var cmdExportMessagesEntry = cmdEntry{
 	name:  "export-messages",
 	alias: "msg",
-	usage: "[-i] [-c conversation] [-d signal-directory] [-f format] [-s interval] [directory]",
+	usage: "[-ivz] [-a archive] [-c conversation] [-d signal-directory] [-f format] [-o order] [-S stats-file] [-s interval] [-Z level] [directory]",
 	exec:  cmdExportMessages,
 }
 
@@ -51,13 +62,18 @@ func cmdExportMessages(args []string) cmdStatus {
 	mode := msgMode{
 		format:      formatText,
 		incremental: false,
+		compress:    false,
+		level:       flate.DefaultCompression,
 	}
 
-	getopt.ParseArgs("c:d:f:is:", args)
-	var dArg, sArg getopt.Arg
+	getopt.ParseArgs("a:c:d:f:io:S:s:vZ:z", args)
+	var aArg, dArg, SArg, sArg getopt.Arg
 	var selectors []string
+	verbose := false
 	for getopt.Next() {
 		switch getopt.Option() {
+		case 'a':
+			aArg = getopt.OptionArg()
 		case 'c':
 			selectors = append(selectors, getopt.OptionArg().String())
 		case 'd':
@@ -75,8 +91,27 @@ func cmdExportMessages(args []string) cmdStatus {
 			}
 		case 'i':
 			mode.incremental = true
+		case 'o':
+			var err error
+			if mode.order, err = parseConversationOrder(getopt.OptionArg().String()); err != nil {
+				log.Fatal(err)
+			}
+		case 'S':
+			SArg = getopt.OptionArg()
 		case 's':
 			sArg = getopt.OptionArg()
+		case 'v':
+			verbose = true
+			mode.progress = true
+		case 'Z':
+			level, err := getopt.OptionArg().Int()
+			if err != nil || level < flate.BestSpeed || level > flate.BestCompression {
+				log.Fatalf("invalid compression level: %s", getopt.OptionArg().String())
+			}
+			mode.compress = true
+			mode.level = level
+		case 'z':
+			mode.compress = true
 		}
 	}
 
@@ -86,10 +121,17 @@ func cmdExportMessages(args []string) cmdStatus {
 
 	args = getopt.Args()
 	var exportDir string
-	switch len(args) {
-	case 0:
+	switch {
+	case aArg.Set():
+		if len(args) != 0 {
+			return cmdUsage
+		}
+		if mode.incremental {
+			log.Fatal("cannot use -a with -i")
+		}
+	case len(args) == 0:
 		exportDir = "."
-	case 1:
+	case len(args) == 1:
 		exportDir = args[0]
 		if err := os.Mkdir(exportDir, 0777); err != nil && !errors.Is(err, fs.ErrExist) {
 			log.Fatal(err)
@@ -122,7 +164,11 @@ func cmdExportMessages(args []string) cmdStatus {
 		log.Fatal(err)
 	}
 
-	if err := openbsd.Unveil(exportDir, "rwc"); err != nil {
+	if err := unveilExportPath(exportDir, aArg); err != nil {
+		log.Fatal(err)
+	}
+
+	if err := unveilStatsFile(SArg); err != nil {
 		log.Fatal(err)
 	}
 
@@ -135,45 +181,111 @@ func cmdExportMessages(args []string) cmdStatus {
 		log.Fatal(err)
 	}
 
-	ctx, err := signal.Open(signalDir)
+	var arc *archive
+	if aArg.Set() {
+		var err error
+		if arc, err = createArchive(aArg.String()); err != nil {
+			log.Fatal(err)
+		}
+	}
+
+	var st *stats.Stats
+	var statsFile *os.File
+	if verbose || SArg.Set() {
+		st = stats.New()
+	}
+	if SArg.Set() {
+		var err error
+		if statsFile, err = os.Create(SArg.String()); err != nil {
+			log.Fatal(err)
+		}
+	}
+	mode.stats = st
+
+	ctx, err := openSignalDir(signalDir)
 	if err != nil {
 		log.Fatal(err)
 	}
 	defer ctx.Close()
+	ctx.SetStats(st)
+
+	// Export a consistent view of the database
+	if err := ctx.BeginRead(); err != nil {
+		log.Print(err)
+		return cmdError
+	}
+
+	// A full export reads most of the database
+	if selectors == nil {
+		ctx.ReadAhead()
+	}
+
+	ok := exportMessages(ctx, exportDir, arc, mode, selectors, ival)
+
+	if arc != nil {
+		if err := arc.close(); err != nil {
+			log.Print(err)
+			return cmdError
+		}
+	}
+
+	if !writeStats(st, verbose, statsFile) {
+		return cmdError
+	}
 
-	if !exportMessages(ctx, exportDir, mode, selectors, ival) {
+	if !ok {
 		return cmdError
 	}
 
 	return cmdOK
 }
 
-func exportMessages(ctx *signal.Context, dir string, mode msgMode, selectors []string, ival signal.Interval) bool {
-	d, err := at.Open(dir)
-	if err != nil {
-		log.Print(err)
-		return false
+// exportMessages exports messages to the directory dir or, if arc is not nil,
+// to the archive arc
+func exportMessages(ctx *signal.Context, dir string, arc *archive, mode msgMode, selectors []string, ival signal.Interval) bool {
+	d := at.InvalidDir
+	if arc == nil {
+		var err error
+		if d, err = at.Open(dir); err != nil {
+			log.Print(err)
+			return false
+		}
+		defer d.Close()
 	}
-	defer d.Close()
 
-	convs, err := selectConversations(ctx, selectors)
+	convs, sums, err := selectNonEmptyConversations(ctx, selectors, ival)
 	if err != nil {
 		log.Print(err)
 		return false
 	}
 
+	sortConversations(convs, mode.order, sums)
+
+	var prog *progress
+	if mode.progress {
+		total := 0
+		for _, conv := range convs {
+			total += sums[conv.ID].Messages
+		}
+		prog = newProgress(total)
+	}
+
 	ret := true
 	for _, conv := range convs {
-		if err = exportConversationMessages(ctx, d, &conv, mode, ival); err != nil {
+		if err = exportConversationMessages(ctx, d, arc, &conv, mode, ival); err != nil {
 			log.Print(err)
 			ret = false
+			if arc != nil && arc.failed() {
+				break
+			}
 		}
+		prog.add(sums[conv.ID].Messages)
 	}
 
 	return ret
 }
 
-func exportConversationMessages(ctx *signal.Context, d at.Dir, conv *signal.Conversation, mode msgMode, ival signal.Interval) error {
+func exportConversationMessages(ctx *signal.Context, d at.Dir, arc *archive, conv *signal.Conversation, mode msgMode, ival signal.Interval) error {
 	msgs, err := ctx.ConversationMessages(conv, ival)
 	if err != nil {
 		return err
@@ -183,21 +295,18 @@ func exportConversationMessages(ctx *signal.Context, d at.Dir, conv *signal.Conv
 		return nil
 	}
 
+	if arc != nil {
+		return archiveConversationMessages(arc, conv, msgs, mode)
+	}
+
 	f, err := conversationFile(d, conv, mode)
 	if err != nil {
 		return err
 	}
-	ew := errio.NewWriter(f)
-
-	switch mode.format {
-	case formatJSON:
-		err = jsonWriteMessages(ew, msgs)
-	case formatText:
-		err = textWriteMessages(ew, msgs)
-	case formatTextShort:
-		err = textShortWriteMessages(ew, msgs)
-	}
 
+	prev := mode.stats.Enter(stats.Format)
+	err = writeConversationFile(mode.stats.Writer(f), msgs, mode)
+	mode.stats.Leave(prev)
 	if err != nil {
 		f.Close()
 		return err
@@ -206,7 +315,60 @@ func exportConversationMessages(ctx *signal.Context, d at.Dir, conv *signal.Conv
 	return f.Close()
 }
 
-func conversationFile(d at.Dir, conv *signal.Conversation, mode msgMode) (*os.File, error) {
+// writeConversationFile writes the messages to w, compressing them if
+// requested
+func writeConversationFile(w io.Writer, msgs []signal.Message, mode msgMode) error {
+	if !mode.compress {
+		return writeMessages(errio.NewWriter(w), msgs, mode)
+	}
+
+	zw, err := pgzip.NewWriterLevel(w, mode.level)
+	if err != nil {
+		return err
+	}
+	if err := writeMessages(errio.NewWriter(zw), msgs, mode); err != nil {
+		zw.Close()
+		return err
+	}
+	return zw.Close()
+}
+
+// archiveConversationMessages adds a conversation file to the archive arc. The
+// modification time of the file is the time the last message was sent.
+func archiveConversationMessages(arc *archive, conv *signal.Conversation, msgs []signal.Message, mode msgMode) error {
+	var buf bytes.Buffer
+	prev := mode.stats.Enter(stats.Format)
+	err := writeConversationFile(&buf, msgs, mode)
+	mode.stats.Leave(prev)
+	if err != nil {
+		return err
+	}
+
+	mtime := time.Now()
+	if t := msgs[len(msgs)-1].TimeSent; t != 0 {
+		mtime = time.UnixMilli(t)
+	}
+
+	name := conversationFilename(conv, mode)
+	defer mode.stats.Leave(mode.stats.Enter(stats.Write))
+	n, err := arc.writeFile(name, int64(buf.Len()), mtime, &buf, !mode.compress)
+	mode.stats.AddBytes(n)
+	return err
+}
+
+func writeMessages(ew *errio.Writer, msgs []signal.Message, mode msgMode) error {
+	switch mode.format {
+	case formatJSON:
+		return jsonWriteMessages(ew, msgs)
+	case formatText:
+		return textWriteMessages(ew, msgs)
+	case formatTextShort:
+		return textShortWriteMessages(ew, msgs)
+	}
+	return nil
+}
+
+func conversationFilename(conv *signal.Conversation, mode msgMode) string {
 	var ext string
 	switch mode.format {
 	case formatJSON:
@@ -214,13 +376,22 @@ func conversationFile(d at.Dir, conv *signal.Conversation, mode msgMode) (*os.Fi
 	case formatText, formatTextShort:
 		ext = ".txt"
 	}
+	if mode.compress {
+		ext += ".gz"
+	}
+	return recipientFilename(conv.Recipient, ext)
+}
 
+func conversationFile(d at.Dir, conv *signal.Conversation, mode msgMode) (*os.File, error) {
 	flags := os.O_WRONLY | os.O_CREATE
 	if !mode.incremental {
 		flags |= os.O_EXCL
+	} else if mode.compress {
+		// A compressed file may shrink
+		flags |= os.O_TRUNC
 	}
 
-	name := recipientFilename(conv.Recipient, ext)
+	name := conversationFilename(conv, mode)
 	f, err := d.OpenFile(name, flags, 0666)
 	if err != nil {
 		return nil, err
@@ -15,30 +15,51 @@
 package main
 
 import (
+	"bufio"
 	"fmt"
 	"log"
+	"os"
 	"strings"
+	"time"
 
 	"github.com/tbvdm/go-openbsd"
 	"github.com/tbvdm/sigtop/getopt"
 	"github.com/tbvdm/sigtop/signal"
+	"github.com/tbvdm/sigtop/sqlcipher"
 )
 
 var cmdQueryDatabaseEntry = cmdEntry{
 	name:  "query-database",
 	alias: "query",
-	usage: "[-d signal-directory] query",
+	usage: "[-i] [-d signal-directory] [-f format] [query]",
 	exec:  cmdQueryDatabase,
 }
 
 func cmdQueryDatabase(args []string) cmdStatus {
-	getopt.ParseArgs("d:", args)
+	getopt.ParseArgs("d:f:i", args)
 
 	var dArg getopt.Arg
+	format := queryFormatText
+	interactive := false
 	for getopt.Next() {
 		switch opt := getopt.Option(); opt {
 		case 'd':
 			dArg = getopt.OptionArg()
+		case 'f':
+			switch arg := getopt.OptionArg().String(); arg {
+			case "csv":
+				format = queryFormatCSV
+			case "ndjson":
+				format = queryFormatNDJSON
+			case "text":
+				format = queryFormatText
+			case "tsv":
+				format = queryFormatTSV
+			default:
+				log.Fatalf("invalid format: %s", arg)
+			}
+		case 'i':
+			interactive = true
 		}
 	}
 
@@ -47,12 +68,15 @@ func cmdQueryDatabase(args []string) cmdStatus {
 	}
 
 	args = getopt.Args()
-	if len(args) != 1 {
+	var query string
+	switch {
+	case interactive && len(args) == 0:
+	case !interactive && len(args) == 1:
+		query = args[0]
+	default:
 		return cmdUsage
 	}
 
-	query := args[0]
-
 	var signalDir string
 	if dArg.Set() {
 		signalDir = dArg.String()
@@ -77,21 +101,161 @@ func cmdQueryDatabase(args []string) cmdStatus {
 		log.Fatal(err)
 	}
 
-	ctx, err := signal.Open(signalDir)
+	ctx, err := openSignalDir(signalDir)
 	if err != nil {
 		log.Fatal(err)
 	}
 	defer ctx.Close()
 
-	rows, err := ctx.QueryDatabase(query)
+	qw := newQueryWriter(os.Stdout, format)
+
+	if interactive {
+		if !queryInteractively(ctx, qw) {
+			return cmdError
+		}
+		return cmdOK
+	}
+
+	err = ctx.QueryDatabase(query, qw.floatText(), qw.writeRow)
+	if ferr := qw.flush(); err == nil {
+		err = ferr
+	}
 	if err != nil {
 		log.Print(err)
 		return cmdError
 	}
 
-	for _, cols := range rows {
-		fmt.Println(strings.Join(cols, "|"))
+	return cmdOK
+}
+
+// queryInteractively reads SQL statements and commands from standard input and
+// executes them. The database connection and its prepared statements are
+// reused across statements.
+func queryInteractively(ctx *signal.Context, qw *queryWriter) bool {
+	// Only show prompts if standard input is a terminal
+	prompt, contPrompt := "", ""
+	if fi, err := os.Stdin.Stat(); err == nil && fi.Mode()&os.ModeCharDevice != 0 {
+		prompt, contPrompt = "sigtop> ", "   ...> "
 	}
 
-	return cmdOK
+	scanner := bufio.NewScanner(os.Stdin)
+	scanner.Buffer(nil, 64*1024*1024)
+
+	ret := true
+	var sql strings.Builder
+	for {
+		if sql.Len() == 0 {
+			fmt.Fprint(os.Stderr, prompt)
+		} else {
+			fmt.Fprint(os.Stderr, contPrompt)
+		}
+
+		if !scanner.Scan() {
+			break
+		}
+		line := scanner.Text()
+
+		if sql.Len() == 0 && strings.HasPrefix(line, ".") {
+			quit, ok := queryCommand(ctx, line)
+			if !ok {
+				ret = false
+			}
+			if quit {
+				return ret
+			}
+			continue
+		}
+
+		sql.WriteString(line)
+		sql.WriteByte('\n')
+		if !sqlcipher.Complete(sql.String()) {
+			continue
+		}
+
+		if !queryTimed(ctx, qw, sql.String()) {
+			ret = false
+		}
+		sql.Reset()
+	}
+
+	if err := scanner.Err(); err != nil {
+		log.Print(err)
+		return false
+	}
+	if strings.TrimSpace(sql.String()) != "" {
+		log.Print("incomplete SQL statement")
+		return false
+	}
+	return ret
+}
+
+// queryTimed executes sql and reports how long it took
+func queryTimed(ctx *signal.Context, qw *queryWriter, sql string) bool {
+	n := 0
+	start := time.Now()
+	err := ctx.QueryDatabase(sql, qw.floatText(), func(cols []string, vals []any) error {
+		n++
+		return qw.writeRow(cols, vals)
+	})
+	if ferr := qw.flush(); err == nil {
+		err = ferr
+	}
+	d := time.Since(start)
+
+	if err != nil {
+		log.Print(err)
+		return false
+	}
+
+	fmt.Fprintf(os.Stderr, "%d rows in %v (%.0f rows/s)\n", n, d.Round(time.Microsecond), float64(n)/d.Seconds())
+	return true
+}
+
+// queryCommand executes a command. It reports whether to quit and whether the
+// command succeeded.
+func queryCommand(ctx *signal.Context, line string) (quit, ok bool) {
+	cmd, arg, _ := strings.Cut(line, " ")
+	arg = strings.TrimSpace(arg)
+
+	switch cmd {
+	case ".explain":
+		if arg != "" {
+			plan, err := ctx.ExplainQuery(arg)
+			if err != nil {
+				log.Print(err)
+				return false, false
+			}
+			printQueryPlan(plan)
+			return false, true
+		}
+		plans, err := ctx.MessageQueryPlans()
+		if err != nil {
+			log.Print(err)
+			return false, false
+		}
+		for i, p := range plans {
+			if i > 0 {
+				fmt.Println()
+			}
+			fmt.Printf("%s: %s\n", p.Name, p.Query)
+			printQueryPlan(p.Plan)
+		}
+		return false, true
+	case ".help":
+		fmt.Println(".explain [query]  show the query plan of a query or of the message queries")
+		fmt.Println(".help             show this help")
+		fmt.Println(".quit             quit")
+		return false, true
+	case ".quit":
+		return true, true
+	default:
+		log.Printf("invalid command: %s", cmd)
+		return false, false
+	}
+}
+
+func printQueryPlan(plan []string) {
+	for _, line := range plan {
+		fmt.Println(line)
+	}
 }
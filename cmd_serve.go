@@ -0,0 +1,300 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package main
+
+import (
+	"bufio"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"io"
+	"log"
+	"net"
+	"os"
+	ossignal "os/signal"
+	"sync"
+	"syscall"
+	"time"
+
+	"github.com/tbvdm/go-openbsd"
+	"github.com/tbvdm/sigtop/getopt"
+	"github.com/tbvdm/sigtop/signal"
+)
+
+var cmdServeEntry = cmdEntry{
+	name:  "serve",
+	usage: "[-d signal-directory] socket",
+	exec:  cmdServe,
+}
+
+// serveRequest is a request read from a client. Exactly one of Query and
+// Messages must be set.
+type serveRequest struct {
+	ID       json.RawMessage `json:"id"`
+	Query    string          `json:"query"`
+	Messages *struct {
+		Conversations []string `json:"conversations"`
+		Interval      string   `json:"interval"`
+	} `json:"messages"`
+}
+
+// serveResponse is a response written to a client. A request results in zero
+// or more responses containing a row or message, followed by a response in
+// which either Done or Error is set.
+type serveResponse struct {
+	ID           json.RawMessage `json:"id,omitempty"`
+	Row          json.RawMessage `json:"row,omitempty"`
+	Conversation string          `json:"conversation,omitempty"`
+	Message      json.RawMessage `json:"message,omitempty"`
+	Done         bool            `json:"done,omitempty"`
+	Error        string          `json:"error,omitempty"`
+}
+
+// serveWriteTimeout is the time after which a client that does not read its
+// responses is disconnected
+const serveWriteTimeout = 30 * time.Second
+
+type server struct {
+	// Every request holds a read lock on mu. This allows the server to
+	// wait for requests in progress before it exits.
+	mu  sync.RWMutex
+	ctx *signal.Context
+}
+
+func cmdServe(args []string) cmdStatus {
+	getopt.ParseArgs("d:", args)
+
+	var dArg getopt.Arg
+	for getopt.Next() {
+		switch opt := getopt.Option(); opt {
+		case 'd':
+			dArg = getopt.OptionArg()
+		}
+	}
+
+	if err := getopt.Err(); err != nil {
+		log.Fatal(err)
+	}
+
+	args = getopt.Args()
+	if len(args) != 1 {
+		return cmdUsage
+	}
+
+	socketPath := args[0]
+
+	var signalDir string
+	if dArg.Set() {
+		signalDir = dArg.String()
+	} else {
+		var err error
+		signalDir, err = signal.DesktopDir()
+		if err != nil {
+			log.Fatal(err)
+		}
+	}
+
+	if err := unveilSignalDir(signalDir); err != nil {
+		log.Fatal(err)
+	}
+
+	if err := openbsd.Unveil(socketPath, "rwc"); err != nil {
+		log.Fatal(err)
+	}
+
+	// For SQLite/SQLCipher
+	if err := openbsd.Unveil("/dev/urandom", "r"); err != nil {
+		log.Fatal(err)
+	}
+
+	if err := openbsd.Pledge("stdio rpath wpath cpath flock unix"); err != nil {
+		log.Fatal(err)
+	}
+
+	// Receive signals from the start, so that the server can shut down
+	// cleanly even if a signal arrives while the database is being opened
+	sigs := make(chan os.Signal, 1)
+	ossignal.Notify(sigs, os.Interrupt, syscall.SIGTERM)
+
+	ctx, err := openSharedSignalDir(signalDir)
+	if err != nil {
+		log.Fatal(err)
+	}
+	defer ctx.Close()
+
+	ln, err := listenUnix(socketPath)
+	if err != nil {
+		log.Print(err)
+		return cmdError
+	}
+
+	go func() {
+		<-sigs
+		ln.Close()
+	}()
+
+	srv := &server{ctx: ctx}
+	for {
+		conn, err := ln.Accept()
+		if err != nil {
+			// Wait for any request in progress before closing the
+			// database
+			srv.mu.Lock()
+			if errors.Is(err, net.ErrClosed) {
+				return cmdOK
+			}
+			ln.Close()
+			log.Print(err)
+			return cmdError
+		}
+		go srv.serveConn(conn)
+	}
+}
+
+// serveConn handles the requests from a client, one at a time. Each client
+// has its own database connection, so that a client does not have to wait for
+// another client's request to finish before its own request starts. The
+// connections share a single page cache, which is guarded by a lock, so pages
+// are still read and decrypted by one connection at a time.
+func (srv *server) serveConn(conn net.Conn) {
+	defer conn.Close()
+
+	// Responses are written while a request holds a read lock on srv.mu,
+	// so a write must not block indefinitely
+	wconn := timeoutConn{conn}
+
+	ctx, err := srv.ctx.Clone()
+	if err != nil {
+		bw := bufio.NewWriter(wconn)
+		writeResponse(bw, serveResponse{Error: err.Error()})
+		bw.Flush()
+		return
+	}
+	defer ctx.Close()
+
+	dec := json.NewDecoder(bufio.NewReader(conn))
+	bw := bufio.NewWriter(wconn)
+
+	for {
+		var req serveRequest
+		if err := dec.Decode(&req); err != nil {
+			if !errors.Is(err, io.EOF) {
+				// The decoder cannot recover from a syntax
+				// error, so give up on this connection
+				writeResponse(bw, serveResponse{Error: err.Error()})
+				bw.Flush()
+			}
+			return
+		}
+
+		resp := serveResponse{ID: req.ID, Done: true}
+		if err := srv.serveRequest(ctx, &req, bw); err != nil {
+			var werr *serveWriteError
+			if errors.As(err, &werr) {
+				return
+			}
+			resp = serveResponse{ID: req.ID, Error: err.Error()}
+		}
+		if writeResponse(bw, resp) != nil || bw.Flush() != nil {
+			return
+		}
+	}
+}
+
+// timeoutConn is a connection on which every write times out after
+// serveWriteTimeout
+type timeoutConn struct {
+	net.Conn
+}
+
+func (c timeoutConn) Write(p []byte) (int, error) {
+	if err := c.SetWriteDeadline(time.Now().Add(serveWriteTimeout)); err != nil {
+		return 0, err
+	}
+	return c.Conn.Write(p)
+}
+
+// serveWriteError is returned when a response cannot be written to the client
+type serveWriteError struct {
+	err error
+}
+
+func (e *serveWriteError) Error() string {
+	return e.err.Error()
+}
+
+// writeResponse writes resp on a single line. Errors from marshalling resp are
+// returned as is; write errors are returned as a serveWriteError.
+func writeResponse(bw *bufio.Writer, resp serveResponse) error {
+	data, err := json.Marshal(resp)
+	if err != nil {
+		return err
+	}
+	if _, err := bw.Write(append(data, '\n')); err != nil {
+		return &serveWriteError{err}
+	}
+	return nil
+}
+
+func (srv *server) serveRequest(ctx *signal.Context, req *serveRequest, bw *bufio.Writer) error {
+	srv.mu.RLock()
+	defer srv.mu.RUnlock()
+
+	if err := ctx.BeginRead(); err != nil {
+		return err
+	}
+	defer ctx.EndRead()
+
+	encode := func(resp serveResponse) error {
+		resp.ID = req.ID
+		return writeResponse(bw, resp)
+	}
+
+	switch {
+	case req.Query != "" && req.Messages == nil:
+		var buf []byte
+		return ctx.QueryDatabase(req.Query, false, func(cols []string, vals []any) error {
+			buf = appendJSONObject(buf[:0], cols, vals)
+			return encode(serveResponse{Row: buf})
+		})
+	case req.Query == "" && req.Messages != nil:
+		var ival signal.Interval
+		if req.Messages.Interval != "" {
+			var err error
+			if ival, err = parseInterval(req.Messages.Interval); err != nil {
+				return err
+			}
+		}
+		convs, err := selectConversations(ctx, req.Messages.Conversations)
+		if err != nil {
+			return err
+		}
+		for _, conv := range convs {
+			msgs, err := ctx.ConversationMessages(&conv, ival)
+			if err != nil {
+				return err
+			}
+			name := conv.Recipient.DetailedDisplayName()
+			for _, msg := range msgs {
+				if err := encode(serveResponse{Conversation: name, Message: json.RawMessage(msg.JSON)}); err != nil {
+					return err
+				}
+			}
+		}
+		return nil
+	default:
+		return fmt.Errorf("request must contain either a query or messages")
+	}
+}
@@ -16,60 +16,206 @@ package main
 
 import (
 	"errors"
+	"fmt"
 	"regexp"
+	"sort"
 	"strings"
 
 	"github.com/tbvdm/sigtop/signal"
 )
 
+// selectConversations returns the conversations selected by selectors, or all
+// conversations if selectors is nil. Phone number and ID selectors are looked
+// up in the database directly. Name and regular expression selectors are
+// matched against the name of every conversation; all regular expressions are
+// combined into one, so that every name is matched only once.
 func selectConversations(ctx *signal.Context, selectors []string) ([]signal.Conversation, error) {
-	allConvs, err := ctx.Conversations()
-	if err != nil {
-		return nil, err
-	}
-
 	if selectors == nil {
-		return allConvs, nil
+		return ctx.Conversations()
 	}
 
 	var selConvs []signal.Conversation
+	selected := make(map[string]bool)
+	add := func(convs []signal.Conversation) {
+		for _, c := range convs {
+			if !selected[c.ID] {
+				selected[c.ID] = true
+				selConvs = append(selConvs, c)
+			}
+		}
+	}
+
+	var names, exprs []string
 	for _, s := range selectors {
-		if len(s) == 0 || (len(s) == 1 && (s[0] == '+' || s[0] == '/' || s[0] == '=')) {
+		if len(s) == 0 || (len(s) == 1 && strings.ContainsRune("+/=@", rune(s[0]))) {
 			return nil, errors.New("empty conversation selector")
 		}
-		var match func(*signal.Recipient) bool
 		switch s[0] {
 		case '+':
-			match = func(r *signal.Recipient) bool {
-				return r.Type == signal.RecipientTypeContact && s == r.Contact.Phone
+			convs, err := ctx.ConversationsByPhone(s)
+			if err != nil {
+				return nil, err
 			}
-		case '/':
-			re, err := regexp.Compile("(?i)" + s[1:])
+			add(convs)
+		case '@':
+			convs, err := ctx.ConversationsByID(s[1:])
 			if err != nil {
 				return nil, err
 			}
-			match = func(r *signal.Recipient) bool {
-				return re.MatchString(r.DisplayName())
+			add(convs)
+		case '/':
+			// Check each expression separately for better error
+			// messages
+			if _, err := regexp.Compile(s[1:]); err != nil {
+				return nil, err
 			}
+			exprs = append(exprs, "(?:"+s[1:]+")")
 		case '=':
-			s = s[1:]
-			fallthrough
+			names = append(names, s[1:])
 		default:
-			match = func(r *signal.Recipient) bool {
-				return strings.EqualFold(s, r.DisplayName())
-			}
+			names = append(names, s)
+		}
+	}
+
+	if names == nil && exprs == nil {
+		return selConvs, nil
+	}
+
+	var re *regexp.Regexp
+	if exprs != nil {
+		var err error
+		if re, err = regexp.Compile("(?i)" + strings.Join(exprs, "|")); err != nil {
+			return nil, err
 		}
+	}
 
-		tmp := allConvs[:0]
-		for _, c := range allConvs {
-			if match(c.Recipient) {
-				selConvs = append(selConvs, c)
-			} else {
-				tmp = append(tmp, c)
-			}
+	allConvs, err := ctx.Conversations()
+	if err != nil {
+		return nil, err
+	}
+
+	for _, c := range allConvs {
+		if selected[c.ID] {
+			continue
+		}
+		name := c.Recipient.DisplayName()
+		if (re != nil && re.MatchString(name)) || matchName(names, name) {
+			add([]signal.Conversation{c})
 		}
-		allConvs = tmp
 	}
 
 	return selConvs, nil
 }
+
+// matchName reports whether name is equal to one of names, ignoring case
+func matchName(names []string, name string) bool {
+	for _, n := range names {
+		if strings.EqualFold(n, name) {
+			return true
+		}
+	}
+	return false
+}
+
+// selectNonEmptyConversations is like selectConversations, but leaves out the
+// conversations that have no messages in the interval ival. It also returns
+// the summaries of the messages of the selected conversations. If selectors
+// is not nil, only the selected conversations are summarised. Otherwise, the
+// summaries determine which conversations are selected, so that only the
+// recipients of those conversations are loaded.
+func selectNonEmptyConversations(ctx *signal.Context, selectors []string, ival signal.Interval) ([]signal.Conversation, map[string]signal.ConversationSummary, error) {
+	if selectors == nil {
+		sums, err := ctx.ConversationSummaries(ival, nil)
+		if err != nil {
+			return nil, nil, err
+		}
+		ids := make([]string, 0, len(sums))
+		for id := range sums {
+			ids = append(ids, id)
+		}
+		convs, err := ctx.ConversationsWithIDs(ids)
+		if err != nil {
+			return nil, nil, err
+		}
+		return convs, sums, nil
+	}
+
+	convs, err := selectConversations(ctx, selectors)
+	if err != nil {
+		return nil, nil, err
+	}
+
+	ids := make([]string, len(convs))
+	for i, c := range convs {
+		ids[i] = c.ID
+	}
+
+	sums, err := ctx.ConversationSummaries(ival, ids)
+	if err != nil {
+		return nil, nil, err
+	}
+
+	nonEmpty := convs[:0]
+	for _, c := range convs {
+		if sums[c.ID].Messages > 0 {
+			nonEmpty = append(nonEmpty, c)
+		}
+	}
+
+	return nonEmpty, sums, nil
+}
+
+type convOrder int
+
+const (
+	orderName convOrder = iota
+	orderActive
+	orderSize
+)
+
+func parseConversationOrder(s string) (convOrder, error) {
+	switch s {
+	case "name":
+		return orderName, nil
+	case "active":
+		return orderActive, nil
+	case "size":
+		return orderSize, nil
+	default:
+		return 0, fmt.Errorf("invalid conversation order: %s", s)
+	}
+}
+
+// sortConversations sorts convs in the order ord: by name, by last activity
+// (most recent first) or by number of messages (largest first). The message
+// counts are taken from sums. Ties are broken by conversation ID, so that the
+// order is the same on every run.
+func sortConversations(convs []signal.Conversation, ord convOrder, sums map[string]signal.ConversationSummary) {
+	var less func(a, b *signal.Conversation) bool
+	switch ord {
+	case orderName:
+		less = func(a, b *signal.Conversation) bool {
+			return strings.ToLower(a.Recipient.DisplayName()) < strings.ToLower(b.Recipient.DisplayName())
+		}
+	case orderActive:
+		less = func(a, b *signal.Conversation) bool {
+			return a.ActiveAt > b.ActiveAt
+		}
+	case orderSize:
+		less = func(a, b *signal.Conversation) bool {
+			return sums[a.ID].Messages > sums[b.ID].Messages
+		}
+	}
+
+	sort.Slice(convs, func(i, j int) bool {
+		a, b := &convs[i], &convs[j]
+		switch {
+		case less(a, b):
+			return true
+		case less(b, a):
+			return false
+		default:
+			return a.ID < b.ID
+		}
+	})
+}
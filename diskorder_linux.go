@@ -0,0 +1,75 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package main
+
+import (
+	"os"
+	"syscall"
+	"unsafe"
+
+	"golang.org/x/sys/unix"
+)
+
+// Based on struct fiemap and struct fiemap_extent in linux/fiemap.h
+type fiemap struct {
+	start         uint64
+	length        uint64
+	flags         uint32
+	mappedExtents uint32
+	extentCount   uint32
+	reserved      uint32
+	extents       [1]fiemapExtent
+}
+
+type fiemapExtent struct {
+	logical    uint64
+	physical   uint64
+	length     uint64
+	reserved64 [2]uint64
+	flags      uint32
+	reserved   [3]uint32
+}
+
+const (
+	fsIocFiemap         = 0xc020660b // _IOWR('f', 11, struct fiemap)
+	fiemapExtentUnknown = 0x2
+)
+
+// fileDiskLocation returns the inode number of f and, if the file system
+// supports the FIEMAP ioctl, the physical offset of the first extent of f.
+func fileDiskLocation(f *os.File) diskLocation {
+	var loc diskLocation
+	if fi, err := f.Stat(); err == nil {
+		if st, ok := fi.Sys().(*syscall.Stat_t); ok {
+			loc.inode = uint64(st.Ino)
+		}
+	}
+
+	fm := fiemap{length: ^uint64(0), extentCount: 1}
+	_, _, errno := unix.Syscall(unix.SYS_IOCTL, f.Fd(), fsIocFiemap, uintptr(unsafe.Pointer(&fm)))
+	if errno == 0 && fm.mappedExtents > 0 && fm.extents[0].flags&fiemapExtentUnknown == 0 {
+		loc.offset = fm.extents[0].physical
+		loc.hasOffset = true
+	}
+
+	return loc
+}
+
+func adviseSequential(f *os.File) {
+	// The advice is merely a hint, so ignore errors
+	fd := int(f.Fd())
+	unix.Fadvise(fd, 0, 0, unix.FADV_SEQUENTIAL)
+	unix.Fadvise(fd, 0, 0, unix.FADV_WILLNEED)
+}
@@ -0,0 +1,37 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+//go:build (unix || aix || darwin || dragonfly || freebsd || hurd || illumos || ios || netbsd || openbsd || solaris) && !(android || linux)
+
+package main
+
+import (
+	"os"
+	"syscall"
+)
+
+// fileDiskLocation returns the inode number of f. The physical offset of f is
+// not available on this platform.
+func fileDiskLocation(f *os.File) diskLocation {
+	var loc diskLocation
+	if fi, err := f.Stat(); err == nil {
+		if st, ok := fi.Sys().(*syscall.Stat_t); ok {
+			loc.inode = uint64(st.Ino)
+		}
+	}
+	return loc
+}
+
+func adviseSequential(f *os.File) {
+}
@@ -0,0 +1,220 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package main
+
+import (
+	"bufio"
+	"encoding/base64"
+	"encoding/csv"
+	"encoding/json"
+	"io"
+	"math"
+	"strconv"
+	"strings"
+)
+
+type queryFormat int
+
+const (
+	queryFormatText queryFormat = iota
+	queryFormatCSV
+	queryFormatTSV
+	queryFormatNDJSON
+)
+
+// queryWriter writes query results in a particular format
+type queryWriter struct {
+	format queryFormat
+	bw     *bufio.Writer
+	cw     *csv.Writer
+	cols   []string
+	buf    []byte
+}
+
+func newQueryWriter(w io.Writer, format queryFormat) *queryWriter {
+	qw := &queryWriter{
+		format: format,
+		bw:     bufio.NewWriterSize(w, 64*1024),
+	}
+	if format == queryFormatCSV {
+		qw.cw = csv.NewWriter(qw.bw)
+	}
+	return qw
+}
+
+// floatText reports whether floats should be passed to writeRow as text. The
+// text formats show floats as SQLite converts them to text; the JSON format
+// needs their exact value.
+func (qw *queryWriter) floatText() bool {
+	return qw.format != queryFormatNDJSON
+}
+
+// writeRow writes a result row. In the CSV and TSV formats, a header is
+// written before the first row and whenever the column names change.
+func (qw *queryWriter) writeRow(cols []string, vals []any) error {
+	switch qw.format {
+	case queryFormatCSV, queryFormatTSV:
+		if !equalStrings(cols, qw.cols) {
+			qw.cols = append(qw.cols[:0], cols...)
+			if err := qw.writeRecord(cols); err != nil {
+				return err
+			}
+		}
+	}
+
+	switch qw.format {
+	case queryFormatText:
+		qw.buf = qw.buf[:0]
+		for i, val := range vals {
+			if i > 0 {
+				qw.buf = append(qw.buf, '|')
+			}
+			qw.buf = appendQueryValue(qw.buf, val)
+		}
+		qw.buf = append(qw.buf, '\n')
+		_, err := qw.bw.Write(qw.buf)
+		return err
+	case queryFormatCSV, queryFormatTSV:
+		fields := make([]string, len(vals))
+		for i, val := range vals {
+			fields[i] = string(appendQueryValue(nil, val))
+		}
+		return qw.writeRecord(fields)
+	case queryFormatNDJSON:
+		qw.buf = appendJSONObject(qw.buf[:0], cols, vals)
+		qw.buf = append(qw.buf, '\n')
+		_, err := qw.bw.Write(qw.buf)
+		return err
+	}
+	return nil
+}
+
+func (qw *queryWriter) writeRecord(fields []string) error {
+	if qw.format == queryFormatCSV {
+		return qw.cw.Write(fields)
+	}
+
+	// Use the usual escape sequences for characters that cannot appear in
+	// a TSV field
+	qw.buf = qw.buf[:0]
+	for i, field := range fields {
+		if i > 0 {
+			qw.buf = append(qw.buf, '\t')
+		}
+		qw.buf = append(qw.buf, tsvReplacer.Replace(field)...)
+	}
+	qw.buf = append(qw.buf, '\n')
+	_, err := qw.bw.Write(qw.buf)
+	return err
+}
+
+var tsvReplacer = strings.NewReplacer("\\", "\\\\", "\t", "\\t", "\n", "\\n", "\r", "\\r")
+
+// flush writes any buffered data
+func (qw *queryWriter) flush() error {
+	if qw.cw != nil {
+		qw.cw.Flush()
+		if err := qw.cw.Error(); err != nil {
+			return err
+		}
+	}
+	return qw.bw.Flush()
+}
+
+// appendQueryValue appends the text representation of val, which is similar
+// to that returned by sqlite3_column_text(). Floats are expected to have been
+// converted to text already.
+func appendQueryValue(b []byte, val any) []byte {
+	switch val := val.(type) {
+	case int64:
+		return strconv.AppendInt(b, val, 10)
+	case string:
+		return append(b, val...)
+	case []byte:
+		return append(b, val...)
+	}
+	return b
+}
+
+// appendJSONObject appends a JSON object with a member for each column.
+// Integers and floats become numbers, text becomes a string, blobs become a
+// base64-encoded string and NULL becomes null.
+func appendJSONObject(b []byte, cols []string, vals []any) []byte {
+	b = append(b, '{')
+	for i, val := range vals {
+		if i > 0 {
+			b = append(b, ',')
+		}
+		b = appendJSONString(b, cols[i])
+		b = append(b, ':')
+		switch val := val.(type) {
+		case int64:
+			b = strconv.AppendInt(b, val, 10)
+		case float64:
+			if math.IsInf(val, 0) || math.IsNaN(val) {
+				b = append(b, "null"...)
+			} else {
+				b = appendFloat(b, val)
+			}
+		case string:
+			b = appendJSONString(b, val)
+		case []byte:
+			n := len(b) + 1
+			b = append(b, make([]byte, base64.StdEncoding.EncodedLen(len(val))+2)...)
+			base64.StdEncoding.Encode(b[n:], val)
+			b[n-1] = '"'
+			b[len(b)-1] = '"'
+		default:
+			b = append(b, "null"...)
+		}
+	}
+	return append(b, '}')
+}
+
+// appendFloat appends f with the shortest representation that round-trips,
+// always with a decimal point or exponent, so that it can be told apart from
+// an integer
+func appendFloat(b []byte, f float64) []byte {
+	n := len(b)
+	b = strconv.AppendFloat(b, f, 'g', -1, 64)
+	if math.IsInf(f, 0) || math.IsNaN(f) {
+		return b
+	}
+	for _, c := range b[n:] {
+		if c == '.' || c == 'e' {
+			return b
+		}
+	}
+	return append(b, ".0"...)
+}
+
+func appendJSONString(b []byte, s string) []byte {
+	// json.Marshal never fails for strings. Invalid UTF-8 is replaced with
+	// U+FFFD.
+	j, _ := json.Marshal(s)
+	return append(b, j...)
+}
+
+func equalStrings(a, b []string) bool {
+	if len(a) != len(b) {
+		return false
+	}
+	for i := range a {
+		if a[i] != b[i] {
+			return false
+		}
+	}
+	return true
+}
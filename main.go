@@ -15,13 +15,20 @@
 package main
 
 import (
+	"fmt"
 	"log"
+	"math"
 	"os"
+	ossignal "os/signal"
 	"path/filepath"
+	"strconv"
+	"syscall"
 
 	"github.com/tbvdm/go-cli"
 	"github.com/tbvdm/go-openbsd"
+	"github.com/tbvdm/sigtop/getopt"
 	"github.com/tbvdm/sigtop/signal"
+	"github.com/tbvdm/sigtop/stats"
 )
 
 type cmdStatus int
@@ -39,6 +46,9 @@ type cmdEntry struct {
 	exec  func([]string) cmdStatus
 }
 
+// snapshot is true if the -B option was specified
+var snapshot bool
+
 var cmdEntries = []cmdEntry{
 	cmdCheckDatabaseEntry,
 	cmdExportAvatarsEntry,
@@ -46,21 +56,75 @@ var cmdEntries = []cmdEntry{
 	cmdExportDatabaseEntry,
 	cmdExportMessagesEntry,
 	cmdQueryDatabaseEntry,
+	cmdServeEntry,
 }
 
 func main() {
 	cli.SetLog()
 
-	if len(os.Args) < 2 {
-		cli.ExitUsage("command", "[argument ...]")
+	getopt.Parse("BC:M:P:TX:")
+	var CArg, MArg, XArg getopt.Arg
+	trace := false
+	for getopt.Next() {
+		switch getopt.Option() {
+		case 'B':
+			snapshot = true
+		case 'C':
+			CArg = getopt.OptionArg()
+		case 'M':
+			MArg = getopt.OptionArg()
+		case 'P':
+			size, err := parseSize(getopt.OptionArg().String())
+			if err != nil {
+				log.Fatalf("invalid cache size: %v", err)
+			}
+			signal.SetCacheSize(size)
+		case 'T':
+			trace = true
+		case 'X':
+			XArg = getopt.OptionArg()
+		}
+	}
+
+	if err := getopt.Err(); err != nil {
+		log.Fatal(err)
 	}
 
-	cmd := command(os.Args[1])
+	args := getopt.Args()
+	if len(args) < 1 {
+		cli.ExitUsage("[-BT] [-C cpu-profile] [-M mem-profile] [-P cache-size] [-X exec-trace] command", "[argument ...]")
+	}
+
+	cmd := command(args[0])
 	if cmd == nil {
-		log.Fatalln("invalid command:", os.Args[1])
+		log.Fatalln("invalid command:", args[0])
+	}
+
+	if trace {
+		signal.SetTrace(os.Stderr)
+	} else if path := os.Getenv("SIGTOP_TRACE"); path != "" {
+		f, err := os.OpenFile(path, os.O_WRONLY|os.O_CREATE|os.O_APPEND, 0666)
+		if err != nil {
+			log.Fatal(err)
+		}
+		signal.SetTrace(f)
+	}
+
+	prof, err := startProfiling(CArg.String(), MArg.String(), XArg.String())
+	if err != nil {
+		log.Fatal(err)
 	}
 
-	switch cmd.exec(os.Args[2:]) {
+	status := cmd.exec(args[1:])
+
+	if err := prof.stop(); err != nil {
+		log.Print(err)
+		if status == cmdOK {
+			status = cmdError
+		}
+	}
+
+	switch status {
 	case cmdError:
 		os.Exit(1)
 	case cmdUsage:
@@ -68,6 +132,33 @@ func main() {
 	}
 }
 
+// parseSize parses a size in bytes. The size may have a K, M or G suffix.
+func parseSize(s string) (int64, error) {
+	mult := int64(1)
+	if n := len(s); n > 0 {
+		switch s[n-1] {
+		case 'K', 'k':
+			mult = 1 << 10
+		case 'M', 'm':
+			mult = 1 << 20
+		case 'G', 'g':
+			mult = 1 << 30
+		}
+		if mult > 1 {
+			s = s[:n-1]
+		}
+	}
+
+	size, err := strconv.ParseInt(s, 10, 64)
+	if err != nil {
+		return 0, err
+	}
+	if size < 0 || size > math.MaxInt64/mult {
+		return 0, fmt.Errorf("%s: out of range", s)
+	}
+	return size * mult, nil
+}
+
 func command(name string) *cmdEntry {
 	for _, cmd := range cmdEntries {
 		if name == cmd.name || name == cmd.alias {
@@ -96,9 +187,122 @@ func unveilSignalDir(dir string) error {
 		return err
 	}
 
+	if snapshot {
+		// For the temporary copy of the database
+		if err := openbsd.Unveil(os.TempDir(), "rwc"); err != nil {
+			return err
+		}
+	}
+
 	return nil
 }
 
+// openSignalDir opens the Signal Desktop directory dir or, if the -B option
+// was specified, a temporary copy of its database
+func openSignalDir(dir string) (*signal.Context, error) {
+	if !snapshot {
+		return signal.Open(dir)
+	}
+	tmpDir, _, err := makeSnapshotDir()
+	if err != nil {
+		return nil, err
+	}
+	return signal.OpenSnapshot(dir, tmpDir)
+}
+
+// openSharedSignalDir is like openSignalDir, but opens the database in
+// shared-cache mode, so that connections cloned from the context share its
+// page cache. The temporary copy of the database is removed on a signal only
+// while it is being made; afterwards, the caller must handle interrupt and
+// termination signals and close the context. The caller should start
+// receiving those signals before calling openSharedSignalDir, so that none
+// are lost in between.
+func openSharedSignalDir(dir string) (*signal.Context, error) {
+	if !snapshot {
+		return signal.OpenShared(dir)
+	}
+	tmpDir, stop, err := makeSnapshotDir()
+	if err != nil {
+		return nil, err
+	}
+	defer stop()
+	return signal.OpenSnapshotShared(dir, tmpDir)
+}
+
+// makeSnapshotDir creates a temporary directory for a copy of the database.
+// Until stop is called, the directory is removed and the process exits if the
+// process receives an interrupt or termination signal, so that interrupting a
+// command, even while the database is being copied, does not leave the copy
+// behind.
+func makeSnapshotDir() (dir string, stop func(), err error) {
+	dir, err = os.MkdirTemp("", "sigtop-")
+	if err != nil {
+		return "", nil, err
+	}
+
+	sigs := make(chan os.Signal, 1)
+	done := make(chan struct{})
+	ossignal.Notify(sigs, os.Interrupt, syscall.SIGTERM)
+	go func() {
+		select {
+		case <-sigs:
+			os.RemoveAll(dir)
+			os.Exit(1)
+		case <-done:
+		}
+	}()
+
+	stop = func() {
+		ossignal.Stop(sigs)
+		close(done)
+	}
+	return dir, stop, nil
+}
+
+// unveilExportPath unveils the export directory dir or, if the -a option was
+// specified, the archive file
+func unveilExportPath(dir string, aArg getopt.Arg) error {
+	switch {
+	case !aArg.Set():
+		return openbsd.Unveil(dir, "rwc")
+	case aArg.String() == "-":
+		return nil
+	default:
+		return openbsd.Unveil(aArg.String(), "rwc")
+	}
+}
+
+// unveilStatsFile unveils the statistics file, if the -S option was specified
+func unveilStatsFile(SArg getopt.Arg) error {
+	if !SArg.Set() {
+		return nil
+	}
+	return openbsd.Unveil(SArg.String(), "rwc")
+}
+
+// writeStats writes a summary of the statistics to standard error if verbose
+// is true, and the statistics in JSON format to f if f is not nil
+func writeStats(st *stats.Stats, verbose bool, f *os.File) bool {
+	ret := true
+	if verbose {
+		if err := st.WriteTable(os.Stderr); err != nil {
+			log.Print(err)
+			ret = false
+		}
+	}
+	if f != nil {
+		if err := st.WriteJSON(f); err != nil {
+			log.Print(err)
+			ret = false
+		}
+		if err := f.Close(); err != nil {
+			log.Print(err)
+			ret = false
+		}
+	}
+	return ret
+}
+
 func recipientFilename(rpt *signal.Recipient, ext string) string {
 	return sanitiseFilename(rpt.DetailedDisplayName() + ext)
 }
@@ -0,0 +1,227 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+// Package pgzip implements a gzip writer that compresses blocks of data in
+// parallel. The output is a single gzip member, like that of pigz: each block
+// is compressed independently, with the last 32 KiB of the preceding block as
+// its dictionary, and is terminated with a sync flush, so that the compressed
+// blocks can simply be concatenated.
+package pgzip
+
+import (
+	"bytes"
+	"compress/flate"
+	"encoding/binary"
+	"errors"
+	"hash/crc32"
+	"io"
+	"runtime"
+	"sync"
+)
+
+const (
+	DefaultBlockSize = 1 << 20
+
+	dictSize = 32 << 10
+)
+
+type block struct {
+	data  []byte
+	dict  []byte
+	final bool
+	out   bytes.Buffer
+	err   error
+	done  chan struct{}
+}
+
+type Writer struct {
+	w         io.Writer
+	level     int
+	blockSize int
+	buf       []byte
+	dict      []byte
+	crc       uint32
+	size      uint32
+	queue     chan *block
+	wg        sync.WaitGroup
+	mu        sync.Mutex
+	err       error
+	closed    bool
+}
+
+// NewWriter returns a Writer that compresses with the default compression
+// level.
+func NewWriter(w io.Writer) *Writer {
+	zw, _ := NewWriterLevel(w, flate.DefaultCompression)
+	return zw
+}
+
+// NewWriterLevel returns a Writer that compresses with the specified
+// compression level. The level is as in the compress/flate package.
+func NewWriterLevel(w io.Writer, level int) (*Writer, error) {
+	if level < flate.HuffmanOnly || level > flate.BestCompression {
+		return nil, errors.New("pgzip: invalid compression level")
+	}
+
+	zw := &Writer{
+		w:         w,
+		level:     level,
+		blockSize: DefaultBlockSize,
+		queue:     make(chan *block, runtime.GOMAXPROCS(0)),
+	}
+
+	zw.wg.Add(1)
+	go zw.writeBlocks()
+
+	return zw, nil
+}
+
+func (zw *Writer) Write(p []byte) (int, error) {
+	if err := zw.error(); err != nil {
+		return 0, err
+	}
+	if zw.closed {
+		return 0, errors.New("pgzip: write to closed writer")
+	}
+
+	zw.crc = crc32.Update(zw.crc, crc32.IEEETable, p)
+	zw.size += uint32(len(p))
+
+	n := len(p)
+	for len(p) > 0 {
+		if zw.buf == nil {
+			zw.buf = make([]byte, 0, zw.blockSize)
+		}
+		m := copy(zw.buf[len(zw.buf):cap(zw.buf)], p)
+		zw.buf = zw.buf[:len(zw.buf)+m]
+		p = p[m:]
+		if len(zw.buf) == cap(zw.buf) {
+			zw.compressBlock(false)
+		}
+	}
+
+	return n, nil
+}
+
+// Close compresses any remaining data, waits until all compressed data has
+// been written and writes the gzip trailer. It does not close the underlying
+// writer.
+func (zw *Writer) Close() error {
+	if zw.closed {
+		return zw.error()
+	}
+	zw.closed = true
+
+	zw.compressBlock(true)
+	close(zw.queue)
+	zw.wg.Wait()
+
+	if err := zw.error(); err != nil {
+		return err
+	}
+
+	var trailer [8]byte
+	binary.LittleEndian.PutUint32(trailer[0:], zw.crc)
+	binary.LittleEndian.PutUint32(trailer[4:], zw.size)
+	_, err := zw.w.Write(trailer[:])
+	return err
+}
+
+// compressBlock starts compressing the buffered data in the background
+func (zw *Writer) compressBlock(final bool) {
+	b := &block{
+		data:  zw.buf,
+		dict:  zw.dict,
+		final: final,
+		done:  make(chan struct{}),
+	}
+
+	if !final {
+		// Keep the tail of this block as the dictionary of the next
+		// one
+		n := len(zw.buf)
+		if n > dictSize {
+			n = dictSize
+		}
+		zw.dict = append([]byte(nil), zw.buf[len(zw.buf)-n:]...)
+	}
+	zw.buf = nil
+
+	go b.compress(zw.level)
+
+	// This blocks if too many blocks are in flight
+	zw.queue <- b
+}
+
+func (b *block) compress(level int) {
+	defer close(b.done)
+
+	fw, err := flate.NewWriterDict(&b.out, level, b.dict)
+	if err != nil {
+		b.err = err
+		return
+	}
+	if _, err := fw.Write(b.data); err != nil {
+		b.err = err
+		return
+	}
+	if b.final {
+		b.err = fw.Close()
+	} else {
+		b.err = fw.Flush()
+	}
+}
+
+// writeBlocks writes the gzip header and then the compressed blocks, in order
+func (zw *Writer) writeBlocks() {
+	defer zw.wg.Done()
+
+	// See RFC 1952
+	xfl := byte(0)
+	switch zw.level {
+	case flate.BestCompression:
+		xfl = 2
+	case flate.BestSpeed:
+		xfl = 4
+	}
+	header := []byte{0x1f, 0x8b, 8, 0, 0, 0, 0, 0, xfl, 255}
+	_, err := zw.w.Write(header)
+
+	for b := range zw.queue {
+		<-b.done
+		if err == nil {
+			err = b.err
+		}
+		if err == nil {
+			_, err = zw.w.Write(b.out.Bytes())
+		}
+		if err != nil {
+			zw.setError(err)
+		}
+	}
+}
+
+func (zw *Writer) error() error {
+	zw.mu.Lock()
+	defer zw.mu.Unlock()
+	return zw.err
+}
+
+func (zw *Writer) setError(err error) {
+	zw.mu.Lock()
+	defer zw.mu.Unlock()
+	if zw.err == nil {
+		zw.err = err
+	}
+}
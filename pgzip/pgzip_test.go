@@ -0,0 +1,86 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package pgzip
+
+import (
+	"bytes"
+	"compress/flate"
+	"compress/gzip"
+	"io"
+	"math/rand"
+	"testing"
+)
+
+func TestRoundTrip(t *testing.T) {
+	// Compressible data spanning several blocks, with matches across
+	// block boundaries
+	words := []string{"foo ", "bar ", "baz ", "qux\n"}
+	rnd := rand.New(rand.NewSource(1))
+	var data []byte
+	for len(data) < DefaultBlockSize+2*dictSize+12345 {
+		data = append(data, words[rnd.Intn(len(words))]...)
+	}
+
+	for _, size := range []int{0, 1, dictSize + 1, len(data)} {
+		for _, level := range []int{flate.HuffmanOnly, flate.BestSpeed, flate.DefaultCompression, flate.BestCompression} {
+			testRoundTrip(t, data[:size], level)
+		}
+	}
+}
+
+func testRoundTrip(t *testing.T, data []byte, level int) {
+	var buf bytes.Buffer
+	zw, err := NewWriterLevel(&buf, level)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// Write in odd-sized chunks
+	for p := data; len(p) > 0; {
+		n := 4093
+		if n > len(p) {
+			n = len(p)
+		}
+		if _, err := zw.Write(p[:n]); err != nil {
+			t.Fatal(err)
+		}
+		p = p[n:]
+	}
+	if err := zw.Close(); err != nil {
+		t.Fatal(err)
+	}
+
+	zr, err := gzip.NewReader(&buf)
+	if err != nil {
+		t.Fatal(err)
+	}
+	zr.Multistream(false)
+	out, err := io.ReadAll(zr)
+	if err != nil {
+		t.Fatalf("size %d, level %d: %v", len(data), level, err)
+	}
+	if !bytes.Equal(out, data) {
+		t.Fatalf("size %d, level %d: data mismatch", len(data), level)
+	}
+	if buf.Len() != 0 {
+		t.Fatalf("size %d, level %d: %d bytes of trailing data", len(data), level, buf.Len())
+	}
+}
+
+func TestInvalidLevel(t *testing.T) {
+	if _, err := NewWriterLevel(io.Discard, 10); err == nil {
+		t.Fatal("no error for invalid compression level")
+	}
+}
@@ -0,0 +1,102 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package main
+
+import (
+	"os"
+	"runtime"
+	"runtime/pprof"
+	"runtime/trace"
+)
+
+// profiler writes CPU and heap profiles and execution traces. The files are
+// created before the command runs, so that they can still be written after
+// the command has restricted file system access.
+type profiler struct {
+	cpuFile   *os.File
+	memFile   *os.File
+	traceFile *os.File
+}
+
+// startProfiling starts profiling. Empty paths are ignored.
+func startProfiling(cpuPath, memPath, tracePath string) (*profiler, error) {
+	p := &profiler{}
+
+	if cpuPath != "" {
+		f, err := os.Create(cpuPath)
+		if err != nil {
+			return nil, err
+		}
+		if err := pprof.StartCPUProfile(f); err != nil {
+			f.Close()
+			return nil, err
+		}
+		p.cpuFile = f
+	}
+
+	if memPath != "" {
+		f, err := os.Create(memPath)
+		if err != nil {
+			p.stop()
+			return nil, err
+		}
+		p.memFile = f
+	}
+
+	if tracePath != "" {
+		f, err := os.Create(tracePath)
+		if err != nil {
+			p.stop()
+			return nil, err
+		}
+		if err := trace.Start(f); err != nil {
+			f.Close()
+			p.stop()
+			return nil, err
+		}
+		p.traceFile = f
+	}
+
+	return p, nil
+}
+
+// stop stops profiling and writes the heap profile
+func (p *profiler) stop() error {
+	var firstErr error
+	setErr := func(err error) {
+		if firstErr == nil {
+			firstErr = err
+		}
+	}
+
+	if p.cpuFile != nil {
+		pprof.StopCPUProfile()
+		setErr(p.cpuFile.Close())
+	}
+
+	if p.traceFile != nil {
+		trace.Stop()
+		setErr(p.traceFile.Close())
+	}
+
+	if p.memFile != nil {
+		// Get up-to-date statistics
+		runtime.GC()
+		setErr(pprof.WriteHeapProfile(p.memFile))
+		setErr(p.memFile.Close())
+	}
+
+	return firstErr
+}
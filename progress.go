@@ -0,0 +1,57 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package main
+
+import (
+	"log"
+	"time"
+)
+
+// How often progress is reported
+const progressInterval = time.Second
+
+// progress reports the progress of an export to standard error. All methods
+// may be called on a nil *progress, in which case they do nothing.
+type progress struct {
+	total int
+	done  int
+	start time.Time
+	last  time.Time
+}
+
+// newProgress returns a progress reporter for an export of total messages
+func newProgress(total int) *progress {
+	now := time.Now()
+	return &progress{total: total, start: now, last: now}
+}
+
+// add records that n more messages have been exported. The progress is
+// reported if it has not been reported recently.
+func (p *progress) add(n int) {
+	if p == nil {
+		return
+	}
+	p.done += n
+	now := time.Now()
+	if p.done == 0 || p.done >= p.total || now.Sub(p.last) < progressInterval {
+		return
+	}
+	p.last = now
+
+	// Estimate the remaining time from the average rate so far
+	elapsed := now.Sub(p.start)
+	eta := time.Duration(float64(elapsed) * float64(p.total-p.done) / float64(p.done))
+	log.Printf("%d of %d messages (%d%%), about %s remaining", p.done, p.total, 100*p.done/p.total, eta.Round(time.Second))
+}
@@ -15,6 +15,7 @@
 package signal
 
 import (
+	"io/fs"
 	"os"
 	"path/filepath"
 	"strings"
@@ -61,7 +62,9 @@ func (c *Context) ConversationAttachments(conv *Conversation, ival Interval) ([]
 		return nil, err
 	}
 
-	var atts []Attachment
+	// The summary only gives an estimate of the number of attachments
+	sum, _ := c.summary(conv.ID, ival)
+	atts := make([]Attachment, 0, sum.Attachments)
 	for _, msg := range msgs {
 		atts = append(atts, msg.Attachments...)
 	}
@@ -73,11 +76,49 @@ func (c *Context) AttachmentPath(att *Attachment) string {
 	return c.absoluteAttachmentPath(att.Path)
 }
 
+// CheckAttachmentFile checks that the file of the attachment att exists. To
+// avoid a stat call per attachment, the attachment directory is read once and
+// its contents are kept in an index. Only attachments that are not in the
+// index are looked up in the file system.
+func (c *Context) CheckAttachmentFile(att *Attachment) error {
+	c.makeAttachmentIndex()
+	if c.attachmentIndex[c.relativeAttachmentPath(att.Path)] {
+		return nil
+	}
+	_, err := os.Stat(c.AttachmentPath(att))
+	return err
+}
+
+func (c *Context) makeAttachmentIndex() {
+	if c.attachmentIndex != nil {
+		// Nothing to do
+		return
+	}
+
+	c.attachmentIndex = make(map[string]bool)
+
+	// Append a path separator to follow the attachment directory if it is
+	// a symlink
+	root := filepath.Join(c.dir, AttachmentDir) + string(os.PathSeparator)
+
+	// The index is only an optimisation, so ignore errors. Attachments
+	// that could not be indexed are looked up in the file system instead.
+	filepath.WalkDir(root, func(path string, de fs.DirEntry, err error) error {
+		if err == nil && !de.IsDir() {
+			c.attachmentIndex[path[len(root):]] = true
+		}
+		return nil
+	})
+}
+
 func (c *Context) absoluteAttachmentPath(path string) string {
 	if path == "" {
 		return ""
 	}
+	return filepath.Join(c.dir, AttachmentDir, c.relativeAttachmentPath(path))
+}
 
+func (c *Context) relativeAttachmentPath(path string) string {
 	// Replace foreign path separators, if any
 	var foreignSep string
 	if os.PathSeparator == '/' {
@@ -87,5 +128,5 @@ func (c *Context) absoluteAttachmentPath(path string) string {
 	}
 	path = strings.Replace(path, foreignSep, string(os.PathSeparator), -1)
 
-	return filepath.Join(c.dir, AttachmentDir, path)
+	return filepath.Clean(path)
 }
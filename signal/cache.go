@@ -0,0 +1,101 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package signal
+
+import (
+	"fmt"
+	"os"
+
+	"github.com/tbvdm/sigtop/sqlcipher"
+)
+
+const (
+	// Size of the SQLite page cache if it cannot be chosen automatically
+	// (the SQLite default)
+	defaultCacheSize = 2 * 1024 * 1024
+
+	// Upper bound for the automatically chosen page cache size
+	maxAutoCacheSize = 1024 * 1024 * 1024
+)
+
+// cacheSize is the page cache size in bytes. If it is negative, the size is
+// chosen automatically.
+var cacheSize int64 = -1
+
+// SetCacheSize sets the size in bytes of the page cache of contexts opened
+// afterwards. A larger cache avoids reading and decrypting the same database
+// pages repeatedly. If size is 0, the SQLite default of 2 MB is used. If size
+// is negative, the size is chosen automatically, based on the size of the
+// database and the available memory.
+func SetCacheSize(size int64) {
+	cacheSize = size
+}
+
+// autoCacheSize returns a page cache size that is large enough to hold the
+// database of size dbSize, unless that would take too much of the available
+// memory
+func autoCacheSize(dbSize int64) int64 {
+	size := dbSize
+	if mem := availableMemory(); mem > 0 && size > mem/4 {
+		size = mem / 4
+	}
+	if size > maxAutoCacheSize {
+		size = maxAutoCacheSize
+	}
+	if size < defaultCacheSize {
+		size = defaultCacheSize
+	}
+	return size
+}
+
+// setCacheSize sets the page cache size of db
+func setCacheSize(db *sqlcipher.DB, dbSize int64) error {
+	size := cacheSize
+	switch {
+	case size < 0:
+		size = autoCacheSize(dbSize)
+	case size == 0:
+		size = defaultCacheSize
+	}
+
+	// A negative cache size is in KiB
+	if err := db.Execf("PRAGMA cache_size = %d", -(size+1023)/1024); err != nil {
+		return fmt.Errorf("cannot set cache size: %w", err)
+	}
+	return nil
+}
+
+// ReadAhead advises the kernel to start reading the database in the
+// background. Call it before operations that read most of the database, such
+// as a full export.
+func (c *Context) ReadAhead() {
+	f, err := os.Open(c.dbFile)
+	if err != nil {
+		return
+	}
+	defer f.Close()
+	if fi, err := f.Stat(); err == nil {
+		adviseDatabase(f, fi.Size())
+	}
+}
+
+// adviseDatabase tells the kernel that the database file f of size dbSize will
+// be read soon, so that it can start reading it in the background. This is
+// only done if the database fits easily in the available memory.
+func adviseDatabase(f *os.File, dbSize int64) {
+	if mem := availableMemory(); mem > 0 && dbSize <= mem/4 {
+		adviseWillNeed(f)
+	}
+}
@@ -14,22 +14,170 @@
 
 package signal
 
+import (
+	"sort"
+	"strings"
+
+	"github.com/tbvdm/sigtop/sqlcipher"
+	"github.com/tbvdm/sigtop/stats"
+)
+
 type Conversation struct {
 	ID        string
 	Recipient *Recipient
+	ActiveAt  int64 // Time of the last activity in the conversation
 }
 
+// Conversations returns all conversations, sorted by ID
 func (c *Context) Conversations() ([]Conversation, error) {
-	if err := c.makeRecipientMaps(); err != nil {
+	prev := c.stats.Enter(stats.Recipients)
+	err := c.makeRecipientMaps()
+	c.stats.Leave(prev)
+	if err != nil {
 		return nil, err
 	}
 
 	list := make([]Conversation, 0, len(c.recipientsByConversationID))
 
 	for id, rpt := range c.recipientsByConversationID {
-		conv := Conversation{id, rpt}
+		if rpt == nil {
+			// Looked up, but does not exist
+			continue
+		}
+		conv := Conversation{
+			ID:        id,
+			Recipient: rpt,
+			ActiveAt:  c.activeAtByConversationID[id],
+		}
+		list = append(list, conv)
+	}
+
+	// Do not depend on the iteration order of the map
+	sort.Slice(list, func(i, j int) bool { return list[i].ID < list[j].ID })
+
+	return list, nil
+}
+
+// ConversationsWithIDs returns the conversations with the specified
+// conversation IDs, sorted by ID. IDs of conversations that do not exist are
+// ignored. Only the recipients of these conversations are read from the
+// database.
+func (c *Context) ConversationsWithIDs(ids []string) ([]Conversation, error) {
+	prev := c.stats.Enter(stats.Recipients)
+	err := c.loadRecipients(ids)
+	c.stats.Leave(prev)
+	if err != nil {
+		return nil, err
+	}
+
+	list := make([]Conversation, 0, len(ids))
+	for _, id := range ids {
+		rpt := c.recipientsByConversationID[id]
+		if rpt == nil {
+			continue
+		}
+		conv := Conversation{
+			ID:        id,
+			Recipient: rpt,
+			ActiveAt:  c.activeAtByConversationID[id],
+		}
 		list = append(list, conv)
 	}
 
+	sort.Slice(list, func(i, j int) bool { return list[i].ID < list[j].ID })
+
 	return list, nil
 }
+
+// ConversationsByID returns the conversations with the specified conversation
+// ID or ACI. Only these conversations are read from the database.
+func (c *Context) ConversationsByID(id string) ([]Conversation, error) {
+	// ACIs are stored in lower case, but compare them in a way that can
+	// still use an index
+	switch {
+	case c.dbVersion >= 88:
+		return c.conversationsWhere("id = ? OR serviceId IN (?, ?)", id, id, strings.ToLower(id))
+	case c.dbVersion >= 20:
+		return c.conversationsWhere("id = ? OR uuid IN (?, ?)", id, id, strings.ToLower(id))
+	default:
+		return c.conversationsWhere("id = ?", id)
+	}
+}
+
+// conversationsByACI returns the conversations with the contacts with the
+// specified ACI
+func (c *Context) conversationsByACI(aci string) ([]Conversation, error) {
+	switch {
+	case c.dbVersion >= 88:
+		return c.conversationsWhere("serviceId IN (?, ?)", aci, strings.ToLower(aci))
+	case c.dbVersion >= 20:
+		return c.conversationsWhere("uuid IN (?, ?)", aci, strings.ToLower(aci))
+	default:
+		// Older databases do not store ACIs
+		return nil, nil
+	}
+}
+
+// ConversationsByPhone returns the conversations with the contacts with the
+// specified phone number. Only these conversations are read from the
+// database.
+func (c *Context) ConversationsByPhone(phone string) ([]Conversation, error) {
+	if c.dbVersion >= 20 {
+		return c.conversationsWhere("type = 'private' AND e164 = ?", phone)
+	}
+	// Older databases use the phone number as the ID
+	if !strings.HasPrefix(phone, "+") {
+		return nil, nil
+	}
+	return c.conversationsWhere("type = 'private' AND id = ?", phone[1:])
+}
+
+// conversationsWhere returns the conversations that satisfy the SQL condition
+// where. The placeholders in where are bound to args.
+func (c *Context) conversationsWhere(where string, args ...string) ([]Conversation, error) {
+	defer c.stats.Leave(c.stats.Enter(stats.Recipients))
+
+	stmt, _, err := c.db.Prepare(c.recipientQuery() + " WHERE " + where)
+	if err != nil {
+		return nil, err
+	}
+
+	for i, arg := range args {
+		if err := stmt.BindText(i+1, arg); err != nil {
+			stmt.Finalize()
+			return nil, err
+		}
+	}
+
+	rows, err := sqlcipher.Scan[recipientRow](stmt)
+	if err != nil {
+		stmt.Finalize()
+		return nil, err
+	}
+
+	c.initRecipientMaps()
+
+	var convs []Conversation
+	var row recipientRow
+	for rows.Next() {
+		rows.Scan(&row)
+		rpt := c.recipientsByConversationID[row.ID]
+		if rpt == nil {
+			if rpt, err = c.addRecipient(&row); err != nil {
+				stmt.Finalize()
+				return nil, err
+			}
+		}
+		convs = append(convs, Conversation{
+			ID:        row.ID,
+			Recipient: rpt,
+			ActiveAt:  row.ActiveAt,
+		})
+	}
+
+	if err := stmt.Finalize(); err != nil {
+		return nil, err
+	}
+
+	return convs, nil
+}
@@ -0,0 +1,215 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package signal_test
+
+import (
+	"fmt"
+	"strings"
+	"testing"
+
+	"github.com/tbvdm/sigtop/signal"
+	"github.com/tbvdm/sigtop/signal/signaltest"
+)
+
+func TestConversationLookup(t *testing.T) {
+	for _, version := range []int{19, 20, 88} {
+		cfg := signaltest.DefaultConfig()
+		cfg.Version = version
+		cfg.Messages = 1
+		dir := signaltest.Profile(t, cfg)
+
+		// Look up the conversations before and after all recipients
+		// have been loaded
+		for _, loadAll := range []bool{false, true} {
+			ctx, err := signal.Open(dir)
+			if err != nil {
+				t.Fatal(err)
+			}
+
+			var all []signal.Conversation
+			if loadAll {
+				if all, err = ctx.Conversations(); err != nil {
+					t.Fatal(err)
+				}
+			} else {
+				ref, err := signal.Open(dir)
+				if err != nil {
+					t.Fatal(err)
+				}
+				if all, err = ref.Conversations(); err != nil {
+					t.Fatal(err)
+				}
+				ref.Close()
+			}
+
+			for _, want := range all {
+				convs, err := ctx.ConversationsByID(want.ID)
+				if err != nil {
+					t.Fatal(err)
+				}
+				checkLookup(t, version, "ID "+want.ID, convs, &want)
+
+				if want.Recipient.Type != signal.RecipientTypeContact {
+					continue
+				}
+
+				convs, err = ctx.ConversationsByPhone(want.Recipient.Contact.Phone)
+				if err != nil {
+					t.Fatal(err)
+				}
+				checkLookup(t, version, "phone "+want.Recipient.Contact.Phone, convs, &want)
+
+				if aci := want.Recipient.Contact.ACI; aci != "" {
+					convs, err = ctx.ConversationsByID(strings.ToUpper(aci))
+					if err != nil {
+						t.Fatal(err)
+					}
+					checkLookup(t, version, "ACI "+aci, convs, &want)
+				}
+			}
+
+			convs, err := ctx.ConversationsByPhone("+1")
+			if err != nil {
+				t.Fatal(err)
+			}
+			if len(convs) != 0 {
+				t.Errorf("version %d: unknown phone number: got %d conversations, want 0", version, len(convs))
+			}
+
+			ctx.Close()
+		}
+	}
+}
+
+func checkLookup(t *testing.T, version int, what string, convs []signal.Conversation, want *signal.Conversation) {
+	t.Helper()
+	if len(convs) != 1 {
+		t.Errorf("version %d: %s: got %d conversations, want 1", version, what, len(convs))
+		return
+	}
+	got := &convs[0]
+	if got.ID != want.ID || got.ActiveAt != want.ActiveAt || *got.Recipient != *want.Recipient {
+		t.Errorf("version %d: %s: got %+v, want %+v", version, what, got, want)
+	}
+}
+
+func TestLazyRecipients(t *testing.T) {
+	for _, version := range []int{19, 20, 88} {
+		cfg := signaltest.DefaultConfig()
+		cfg.Version = version
+		cfg.Messages = 50
+		cfg.MentionRatio = 0.5
+		cfg.QuoteRatio = 0.5
+		cfg.ReactionRatio = 0.5
+		dir := signaltest.Profile(t, cfg)
+
+		// Load all recipients up front in one context and on demand in
+		// the other
+		eager, err := signal.Open(dir)
+		if err != nil {
+			t.Fatal(err)
+		}
+		convs, err := eager.Conversations()
+		if err != nil {
+			t.Fatal(err)
+		}
+		lazy, err := signal.Open(dir)
+		if err != nil {
+			t.Fatal(err)
+		}
+
+		for _, conv := range convs {
+			want, err := eager.ConversationMessages(&conv, signal.Interval{})
+			if err != nil {
+				t.Fatal(err)
+			}
+			got, err := lazy.ConversationMessages(&conv, signal.Interval{})
+			if err != nil {
+				t.Fatal(err)
+			}
+			if len(got) != len(want) {
+				t.Fatalf("version %d: got %d messages, want %d", version, len(got), len(want))
+			}
+			for i := range got {
+				if g, w := messageRecipients(&got[i]), messageRecipients(&want[i]); g != w {
+					t.Errorf("version %d: got recipients %q, want %q", version, g, w)
+				}
+			}
+		}
+
+		lazy.Close()
+		eager.Close()
+	}
+}
+
+func TestConversationsWithIDs(t *testing.T) {
+	cfg := signaltest.DefaultConfig()
+	cfg.Messages = 1
+	dir := signaltest.Profile(t, cfg)
+
+	eager, err := signal.Open(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer eager.Close()
+	want, err := eager.Conversations()
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// Include enough unknown IDs to need more than one query
+	var ids []string
+	for i := 0; i < 1000; i++ {
+		ids = append(ids, fmt.Sprintf("unknown-%d", i))
+	}
+	for i := len(want) - 1; i >= 0; i-- {
+		ids = append(ids, want[i].ID)
+	}
+
+	lazy, err := signal.Open(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer lazy.Close()
+	got, err := lazy.ConversationsWithIDs(ids)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	if len(got) != len(want) {
+		t.Fatalf("got %d conversations, want %d", len(got), len(want))
+	}
+	for i := range got {
+		if got[i].ID != want[i].ID || got[i].ActiveAt != want[i].ActiveAt ||
+			got[i].Recipient.DetailedDisplayName() != want[i].Recipient.DetailedDisplayName() {
+			t.Errorf("got conversation %s (%s), want %s (%s)", got[i].ID, got[i].Recipient.DetailedDisplayName(), want[i].ID, want[i].Recipient.DetailedDisplayName())
+		}
+	}
+}
+
+// messageRecipients returns the names of the recipients referred to by msg
+func messageRecipients(msg *signal.Message) string {
+	names := []string{msg.Conversation.DetailedDisplayName(), msg.Source.DetailedDisplayName()}
+	for _, mnt := range msg.Body.Mentions {
+		names = append(names, mnt.Recipient.DetailedDisplayName())
+	}
+	if msg.Quote != nil {
+		names = append(names, msg.Quote.Recipient.DetailedDisplayName())
+	}
+	for _, rct := range msg.Reactions {
+		names = append(names, rct.Recipient.DetailedDisplayName())
+	}
+	return strings.Join(names, ", ")
+}
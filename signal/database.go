@@ -16,6 +16,7 @@ package signal
 
 import (
 	"fmt"
+	"strings"
 
 	"github.com/tbvdm/sigtop/sqlcipher"
 )
@@ -76,27 +77,101 @@ func runPragmaCheck(db *sqlcipher.DB, pragma string) ([]string, error) {
 	return results, stmt.Finalize()
 }
 
-func (c *Context) QueryDatabase(sql string) ([][]string, error) {
-	var rows [][]string
-	for sql != "" {
-		var stmt *sqlcipher.Stmt
-		var err error
-		stmt, sql, err = c.db.Prepare(sql)
+// QueryDatabase executes the SQL statements in sql. For every result row, it
+// calls fn with the column names and the column values. Each value is an
+// int64, float64, string, []byte or nil, depending on its type. If floatText
+// is true, floats are passed as strings instead, as converted to text by
+// SQLite. The slices passed to fn are reused and only valid until fn returns.
+// If fn returns an error, QueryDatabase stops and returns that error.
+//
+// If sql contains a single statement, the prepared statement is cached and
+// reused when the same SQL is queried again.
+func (c *Context) QueryDatabase(sql string, floatText bool, fn func(cols []string, vals []any) error) error {
+	if stmt := c.stmtCache[sql]; stmt != nil {
+		return c.queryCachedStatement(sql, stmt, floatText, fn)
+	}
+
+	for first := true; strings.TrimSpace(sql) != ""; first = false {
+		stmt, tail, err := c.db.Prepare(sql)
 		if err != nil {
-			return nil, err
+			return err
 		}
-		for stmt.Step() {
-			cols := make([]string, stmt.ColumnCount())
-			for i := range cols {
-				cols[i] = stmt.ColumnText(i)
-			}
-			rows = append(rows, cols)
+		if first && strings.TrimSpace(tail) == "" {
+			c.cacheStatement(sql, stmt)
+			return c.queryCachedStatement(sql, stmt, floatText, fn)
+		}
+		sql = tail
+		if err = queryStatement(stmt, floatText, fn); err != nil {
+			stmt.Finalize()
+			return err
 		}
 		if err = stmt.Finalize(); err != nil {
-			return nil, err
+			return err
+		}
+	}
+	return nil
+}
+
+// maxCachedStmts is the maximum number of statements cached by QueryDatabase
+const maxCachedStmts = 32
+
+func (c *Context) cacheStatement(sql string, stmt *sqlcipher.Stmt) {
+	if c.stmtCache == nil {
+		c.stmtCache = make(map[string]*sqlcipher.Stmt)
+	}
+	if len(c.stmtCache) >= maxCachedStmts {
+		// Evict an arbitrary statement
+		for s, st := range c.stmtCache {
+			st.Finalize()
+			delete(c.stmtCache, s)
+			break
 		}
 	}
-	return rows, nil
+	c.stmtCache[sql] = stmt
+}
+
+func (c *Context) queryCachedStatement(sql string, stmt *sqlcipher.Stmt, floatText bool, fn func(cols []string, vals []any) error) error {
+	err := queryStatement(stmt, floatText, fn)
+	if rerr := stmt.Reset(); err == nil {
+		err = rerr
+	}
+	if err != nil {
+		delete(c.stmtCache, sql)
+		stmt.Finalize()
+	}
+	return err
+}
+
+func queryStatement(stmt *sqlcipher.Stmt, floatText bool, fn func(cols []string, vals []any) error) error {
+	cols := make([]string, stmt.ColumnCount())
+	for i := range cols {
+		cols[i] = stmt.ColumnName(i)
+	}
+	vals := make([]any, len(cols))
+	for stmt.Step() {
+		for i := range vals {
+			switch stmt.ColumnType(i) {
+			case sqlcipher.ColumnTypeInteger:
+				vals[i] = stmt.ColumnInt64(i)
+			case sqlcipher.ColumnTypeFloat:
+				if floatText {
+					vals[i] = stmt.ColumnText(i)
+				} else {
+					vals[i] = stmt.ColumnDouble(i)
+				}
+			case sqlcipher.ColumnTypeText:
+				vals[i] = stmt.ColumnText(i)
+			case sqlcipher.ColumnTypeBlob:
+				vals[i] = stmt.ColumnBlob(i)
+			case sqlcipher.ColumnTypeNull:
+				vals[i] = nil
+			}
+		}
+		if err := fn(cols, vals); err != nil {
+			return err
+		}
+	}
+	return nil
 }
 
 func (c *Context) WriteDatabase(path string) error {
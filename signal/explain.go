@@ -0,0 +1,79 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package signal
+
+import "strings"
+
+// QueryPlan describes how SQLite executes a query
+type QueryPlan struct {
+	Name  string
+	Query string
+	Plan  []string
+}
+
+// messageQueries contains the message queries for each database version
+var messageQueries = []struct {
+	name                     string
+	query8, query20, query88 string
+}{
+	{"messages", messageQuery8, messageQuery20, messageQuery88},
+	{"messages-sent-before", messageQuerySentBefore8, messageQuerySentBefore20, messageQuerySentBefore88},
+	{"messages-sent-after", messageQuerySentAfter8, messageQuerySentAfter20, messageQuerySentAfter88},
+	{"messages-sent-between", messageQuerySentBetween8, messageQuerySentBetween20, messageQuerySentBetween88},
+}
+
+// MessageQueryPlans returns the query plans of the queries used to retrieve
+// messages
+func (c *Context) MessageQueryPlans() ([]QueryPlan, error) {
+	var plans []QueryPlan
+	for _, q := range messageQueries {
+		var query string
+		switch {
+		case c.dbVersion >= 88:
+			query = q.query88
+		case c.dbVersion >= 20:
+			query = q.query20
+		default:
+			query = q.query8
+		}
+		plan, err := c.ExplainQuery(query)
+		if err != nil {
+			return nil, err
+		}
+		plans = append(plans, QueryPlan{Name: q.name, Query: query, Plan: plan})
+	}
+	return plans, nil
+}
+
+// ExplainQuery returns the query plan of a query as a list of lines, indented
+// to show the structure of the plan
+func (c *Context) ExplainQuery(query string) ([]string, error) {
+	stmt, _, err := c.db.Prepare("EXPLAIN QUERY PLAN " + query)
+	if err != nil {
+		return nil, err
+	}
+
+	var plan []string
+	depth := make(map[int64]int)
+	for stmt.Step() {
+		id := stmt.ColumnInt64(0)
+		parent := stmt.ColumnInt64(1)
+		depth[id] = depth[parent] + 1
+		detail := stmt.ColumnText(3)
+		plan = append(plan, strings.Repeat("  ", depth[id]-1)+detail)
+	}
+
+	return plan, stmt.Finalize()
+}
@@ -22,6 +22,7 @@ import (
 	"time"
 
 	"github.com/tbvdm/sigtop/sqlcipher"
+	"github.com/tbvdm/sigtop/stats"
 )
 
 const (
@@ -38,7 +39,7 @@ const (
 	// For database versions [20, 87]
 	messageSelect20 = "SELECT "             +
 		"m.conversationId, "            +
-		"c.id, "                        +
+		"c.id AS source, "              +
 		"m.type, "                      +
 		"m.body, "                      +
 		"m.json, "                      +
@@ -50,7 +51,7 @@ const (
 	// For database versions >= 88
 	messageSelect88 = "SELECT "             +
 		"m.conversationId, "            +
-		"c.id, "                        +
+		"c.id AS source, "              +
 		"m.type, "                      +
 		"m.body, "                      +
 		"m.json, "                      +
@@ -82,14 +83,17 @@ const (
 	messageQuerySentBetween88 = messageSelect88 + messageWhereConversationIDAndSentBetween + messageOrder
 )
 
-const (
-	messageColumnConversationID = iota
-	messageColumnID
-	messageColumnType
-	messageColumnBody
-	messageColumnJSON
-	messageColumnSentAt
-)
+// Number of messages whose recipients are loaded at once
+const messagePageSize = 64
+
+type messageRow struct {
+	ConversationID sqlcipher.NullString `sql:"conversationId"`
+	SourceID       sqlcipher.NullString `sql:"source"`
+	Type           string               `sql:"type"`
+	Body           string               `sql:"body"`
+	JSON           string               `sql:"json"`
+	SentAt         int64                `sql:"sent_at"`
+}
 
 type messageJSON struct {
 	Attachments  []attachmentJSON `json:"attachments"`
@@ -126,19 +130,26 @@ type Interval struct {
 }
 
 func (c *Context) ConversationMessages(conv *Conversation, ival Interval) ([]Message, error) {
+	// If the conversation is known to have no messages, there is no need
+	// to query them. Otherwise, the summary tells how many there are.
+	sum, ok := c.summary(conv.ID, ival)
+	if ok && sum.Messages == 0 {
+		return nil, nil
+	}
+
 	switch {
 	case ival.Min.IsZero() && ival.Max.IsZero():
-		return c.allConversationMessages(conv)
+		return c.allConversationMessages(conv, sum.Messages)
 	case ival.Min.IsZero():
-		return c.conversationMessagesSentBefore(conv, ival.Max)
+		return c.conversationMessagesSentBefore(conv, ival.Max, sum.Messages)
 	case ival.Max.IsZero():
-		return c.conversationMessagesSentAfter(conv, ival.Min)
+		return c.conversationMessagesSentAfter(conv, ival.Min, sum.Messages)
 	default:
-		return c.conversationMessagesSentBetween(conv, ival.Min, ival.Max)
+		return c.conversationMessagesSentBetween(conv, ival.Min, ival.Max, sum.Messages)
 	}
 }
 
-func (c *Context) allConversationMessages(conv *Conversation) ([]Message, error) {
+func (c *Context) allConversationMessages(conv *Conversation, n int) ([]Message, error) {
 	var query string
 	switch {
 	case c.dbVersion >= 88:
@@ -158,10 +169,10 @@ func (c *Context) allConversationMessages(conv *Conversation) ([]Message, error)
 		return nil, err
 	}
 
-	return c.messages(stmt)
+	return c.messages(stmt, n)
 }
 
-func (c *Context) conversationMessagesSentBefore(conv *Conversation, max time.Time) ([]Message, error) {
+func (c *Context) conversationMessagesSentBefore(conv *Conversation, max time.Time, n int) ([]Message, error) {
 	var query string
 	switch {
 	case c.dbVersion >= 88:
@@ -185,10 +196,10 @@ func (c *Context) conversationMessagesSentBefore(conv *Conversation, max time.Ti
 		return nil, err
 	}
 
-	return c.messages(stmt)
+	return c.messages(stmt, n)
 }
 
-func (c *Context) conversationMessagesSentAfter(conv *Conversation, min time.Time) ([]Message, error) {
+func (c *Context) conversationMessagesSentAfter(conv *Conversation, min time.Time, n int) ([]Message, error) {
 	var query string
 	switch {
 	case c.dbVersion >= 88:
@@ -212,10 +223,10 @@ func (c *Context) conversationMessagesSentAfter(conv *Conversation, min time.Tim
 		return nil, err
 	}
 
-	return c.messages(stmt)
+	return c.messages(stmt, n)
 }
 
-func (c *Context) conversationMessagesSentBetween(conv *Conversation, min, max time.Time) ([]Message, error) {
+func (c *Context) conversationMessagesSentBetween(conv *Conversation, min, max time.Time, n int) ([]Message, error) {
 	var query string
 	switch {
 	case c.dbVersion >= 88:
@@ -243,82 +254,143 @@ func (c *Context) conversationMessagesSentBetween(conv *Conversation, min, max t
 		return nil, err
 	}
 
-	return c.messages(stmt)
+	return c.messages(stmt, n)
 }
 
-func (c *Context) messages(stmt *sqlcipher.Stmt) ([]Message, error) {
-	var msgs []Message
-	for stmt.Step() {
-		var msg Message
-
-		if stmt.ColumnType(messageColumnConversationID) == sqlcipher.ColumnTypeNull {
-			// Likely message with error
-			log.Printf("conversation recipient has null ID")
-		} else {
-			id := stmt.ColumnText(messageColumnConversationID)
-			rpt, err := c.recipientFromConversationID(id)
-			if err != nil {
-				stmt.Finalize()
-				return nil, err
-			}
-			if rpt == nil {
-				log.Printf("cannot find conversation recipient for ID %q", id)
-			}
-			msg.Conversation = rpt
+// messages returns the messages selected by stmt. The number of messages is
+// expected to be n, if n is not 0.
+func (c *Context) messages(stmt *sqlcipher.Stmt, n int) ([]Message, error) {
+	rows, err := sqlcipher.Scan[messageRow](stmt)
+	if err != nil {
+		stmt.Finalize()
+		return nil, err
+	}
+
+	msgs := make([]Message, 0, n)
+	page := make([]messageRow, 0, messagePageSize)
+	for {
+		page = page[:0]
+		for len(page) < messagePageSize && nextRow(c, rows) {
+			page = append(page, rows.Row())
+		}
+		if len(page) == 0 {
+			break
+		}
+
+		if err := c.loadMessageRecipients(page); err != nil {
+			stmt.Finalize()
+			return nil, err
 		}
 
-		if stmt.ColumnType(messageColumnID) != sqlcipher.ColumnTypeNull {
-			id := stmt.ColumnText(messageColumnID)
-			rpt, err := c.recipientFromConversationID(id)
+		for i := range page {
+			msg, err := c.message(&page[i])
 			if err != nil {
 				stmt.Finalize()
 				return nil, err
 			}
-			if rpt == nil {
-				log.Printf("cannot find source recipient for ID %q", id)
-			}
-			msg.Source = rpt
+			msgs = append(msgs, msg)
 		}
+	}
 
-		msg.Type = stmt.ColumnText(messageColumnType)
-		msg.Body.Text = stmt.ColumnText(messageColumnBody)
-		msg.JSON = stmt.ColumnText(messageColumnJSON)
-		msg.TimeSent = stmt.ColumnInt64(messageColumnSentAt)
+	c.stats.AddMessages(len(msgs))
 
-		if err := c.parseMessageJSON(&msg); err != nil {
-			stmt.Finalize()
-			return nil, err
+	return msgs, stmt.Finalize()
+}
+
+// message converts a row of the messages table to a message
+func (c *Context) message(row *messageRow) (Message, error) {
+	var msg Message
+
+	if !row.ConversationID.Valid {
+		// Likely message with error
+		log.Printf("conversation recipient has null ID")
+	} else {
+		id := row.ConversationID.String
+		rpt, err := c.recipientFromConversationID(id)
+		if err != nil {
+			return Message{}, err
+		}
+		if rpt == nil {
+			log.Printf("cannot find conversation recipient for ID %q", id)
 		}
+		msg.Conversation = rpt
+	}
 
-		if err := msg.Body.insertMentions(); err != nil {
-			msg.logError(err, "message with invalid mention")
-			msg.Body.Mentions = nil
+	if row.SourceID.Valid {
+		id := row.SourceID.String
+		rpt, err := c.recipientFromConversationID(id)
+		if err != nil {
+			return Message{}, err
+		}
+		if rpt == nil {
+			log.Printf("cannot find source recipient for ID %q", id)
 		}
+		msg.Source = rpt
+	}
 
-		if msg.Quote != nil {
-			if err := msg.Quote.Body.insertMentions(); err != nil {
-				msg.logError(err, "message with invalid mention in quote")
-				msg.Quote.Body.Mentions = nil
-			}
+	msg.Type = row.Type
+	msg.Body.Text = row.Body
+	msg.JSON = row.JSON
+	msg.TimeSent = row.SentAt
+
+	prev := c.stats.Enter(stats.JSON)
+	err := c.parseMessageJSON(&msg)
+	c.stats.Leave(prev)
+	if err != nil {
+		return Message{}, err
+	}
+
+	prev = c.stats.Enter(stats.Mentions)
+
+	if err := msg.Body.insertMentions(); err != nil {
+		msg.logError(err, "message with invalid mention")
+		msg.Body.Mentions = nil
+	}
+
+	if msg.Quote != nil {
+		if err := msg.Quote.Body.insertMentions(); err != nil {
+			msg.logError(err, "message with invalid mention in quote")
+			msg.Quote.Body.Mentions = nil
 		}
+	}
 
-		for i := range msg.Edits {
-			if err := msg.Edits[i].Body.insertMentions(); err != nil {
-				msg.logError(err, "message with invalid mention in edit %d", i)
-				msg.Edits[i].Body.Mentions = nil
-			}
-			if msg.Edits[i].Quote != nil {
-				if err := msg.Edits[i].Quote.Body.insertMentions(); err != nil {
-					msg.logError(err, "message with invalid mention in quote in edit %d", i)
-					msg.Edits[i].Quote.Body.Mentions = nil
-				}
+	for i := range msg.Edits {
+		if err := msg.Edits[i].Body.insertMentions(); err != nil {
+			msg.logError(err, "message with invalid mention in edit %d", i)
+			msg.Edits[i].Body.Mentions = nil
+		}
+		if msg.Edits[i].Quote != nil {
+			if err := msg.Edits[i].Quote.Body.insertMentions(); err != nil {
+				msg.logError(err, "message with invalid mention in quote in edit %d", i)
+				msg.Edits[i].Quote.Body.Mentions = nil
 			}
 		}
+	}
+
+	c.stats.Leave(prev)
 
-		msgs = append(msgs, msg)
+	return msg, nil
+}
+
+// loadMessageRecipients loads the conversation and source recipients of the
+// messages in page, with one query for the whole page
+func (c *Context) loadMessageRecipients(page []messageRow) error {
+	var ids []string
+	for i := range page {
+		if id := page[i].ConversationID; id.Valid {
+			ids = append(ids, id.String)
+		}
+		if id := page[i].SourceID; id.Valid {
+			ids = append(ids, id.String)
+		}
 	}
+	return c.loadRecipients(ids)
+}
 
-	return msgs, stmt.Finalize()
+// nextRow advances rows and charges the time to the SQL stage
+func nextRow[T any](c *Context, rows *sqlcipher.Rows[T]) bool {
+	defer c.stats.Leave(c.stats.Enter(stats.SQL))
+	return rows.Next()
 }
 
 func (c *Context) parseMessageJSON(msg *Message) error {
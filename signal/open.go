@@ -19,52 +19,77 @@ import (
 	"fmt"
 	"os"
 	"path/filepath"
+	"time"
 
 	"github.com/tbvdm/sigtop/sqlcipher"
+	"github.com/tbvdm/sigtop/stats"
 )
 
+// How long to wait for Signal Desktop to release a lock on the database
+const busyTimeout = 10 * time.Second
+
 type Context struct {
 	dir                        string
+	dbFile                     string
+	tmpDir                     string
+	shared                     bool
 	db                         *sqlcipher.DB
 	dbVersion                  int
 	recipientsByConversationID map[string]*Recipient
 	recipientsByPhone          map[string]*Recipient
 	recipientsByACI            map[string]*Recipient
+	activeAtByConversationID   map[string]int64
+	recipientsLoaded           bool
+	internedStrings            map[string]string
+	attachmentIndex            map[string]bool
+	stmtCache                  map[string]*sqlcipher.Stmt
+	summaries                  map[string]ConversationSummary
+	summaryIval                Interval
+	summaryIDs                 map[string]bool
+	stats                      *stats.Stats
 }
 
 func Open(dir string) (*Context, error) {
-	dbFile := filepath.Join(dir, DatabaseFile)
+	return open(dir, filepath.Join(dir, DatabaseFile), false)
+}
+
+// OpenShared is like Open, but opens the database in shared-cache mode. Use it
+// if the context is going to be cloned: the clones then share the page cache
+// of the context, instead of each reading and decrypting pages on its own.
+func OpenShared(dir string) (*Context, error) {
+	return open(dir, filepath.Join(dir, DatabaseFile), true)
+}
 
+// open opens the database file dbFile of the Signal Desktop directory dir. If
+// shared is true, the database is opened in shared-cache mode.
+func open(dir, dbFile string, shared bool) (*Context, error) {
 	// SQLite/SQLCipher doesn't provide a useful error message if the
 	// database doesn't exist or can't be read
 	f, err := os.Open(dbFile)
 	if err != nil {
 		return nil, err
 	}
+	var dbSize int64
+	if fi, err := f.Stat(); err == nil {
+		dbSize = fi.Size()
+	}
 	f.Close()
 
-	db, err := sqlcipher.OpenFlags(dbFile, sqlcipher.OpenReadOnly)
+	db, err := openDatabase(dbFile, shared)
 	if err != nil {
 		return nil, err
 	}
 
-	key, err := dbKey(dir)
-	if err != nil {
+	if err := keyDatabase(db, dir); err != nil {
 		db.Close()
 		return nil, err
 	}
 
-	if err := db.Key(key); err != nil {
+	if err := setCacheSize(db, dbSize); err != nil {
 		db.Close()
 		return nil, err
 	}
 
-	// Verify key
-	if err := db.Exec("SELECT count(*) FROM sqlite_master"); err != nil {
-		db.Close()
-		return nil, fmt.Errorf("cannot verify key: %w", err)
-	}
-
 	dbVersion, err := databaseVersion(db)
 	if err != nil {
 		db.Close()
@@ -78,6 +103,8 @@ func Open(dir string) (*Context, error) {
 
 	ctx := Context{
 		dir:       dir,
+		dbFile:    dbFile,
+		shared:    shared,
 		db:        db,
 		dbVersion: dbVersion,
 	}
@@ -85,8 +112,103 @@ func Open(dir string) (*Context, error) {
 	return &ctx, nil
 }
 
+// Clone opens a new connection to the database of c. Clone and c can be used
+// concurrently, e.g. by different goroutines. If c was opened with OpenShared,
+// all connections share the page cache of c, so that every page is read and
+// decrypted only once. The page cache is bounded by the size set with
+// SetCacheSize.
+func (c *Context) Clone() (*Context, error) {
+	db, err := openDatabase(c.dbFile, c.shared)
+	if err != nil {
+		return nil, err
+	}
+
+	// A shared cache is already keyed, so there should be no need to key
+	// the new connection. Keying it would replace the cipher context of
+	// the shared cache while other connections may be using it.
+	if !c.shared {
+		err = keyDatabase(db, c.dir)
+	} else if err = db.Exec("SELECT count(*) FROM sqlite_master"); err != nil {
+		// The cache is not shared after all
+		err = keyDatabase(db, c.dir)
+	}
+	if err != nil {
+		db.Close()
+		return nil, err
+	}
+
+	ctx := Context{
+		dir:       c.dir,
+		dbFile:    c.dbFile,
+		shared:    c.shared,
+		db:        db,
+		dbVersion: c.dbVersion,
+	}
+
+	return &ctx, nil
+}
+
+// openDatabase opens the database file in read-only mode and, if shared is
+// true, in shared-cache mode
+func openDatabase(dbFile string, shared bool) (*sqlcipher.DB, error) {
+	flags := sqlcipher.OpenReadOnly
+	if shared {
+		flags |= sqlcipher.OpenSharedCache
+	}
+	db, err := sqlcipher.OpenFlags(dbFile, flags)
+	if err != nil {
+		return nil, err
+	}
+
+	// Signal Desktop may be using the database
+	if err := db.BusyTimeout(busyTimeout); err != nil {
+		db.Close()
+		return nil, err
+	}
+
+	if traceWriter != nil {
+		if err := db.Trace(traceStatement(traceWriter)); err != nil {
+			db.Close()
+			return nil, err
+		}
+	}
+
+	return db, nil
+}
+
+// keyDatabase sets the key of db to the key in the Signal Desktop directory
+// dir and verifies it
+func keyDatabase(db *sqlcipher.DB, dir string) error {
+	key, err := dbKey(dir)
+	if err != nil {
+		return err
+	}
+
+	if err := db.Key(key); err != nil {
+		return err
+	}
+
+	// Verify key
+	if err := db.Exec("SELECT count(*) FROM sqlite_master"); err != nil {
+		return fmt.Errorf("cannot verify key: %w", err)
+	}
+
+	return nil
+}
+
+// SetStats makes c record in st where time is spent
+func (c *Context) SetStats(st *stats.Stats) {
+	c.stats = st
+}
+
 func (c *Context) Close() {
+	for _, stmt := range c.stmtCache {
+		stmt.Finalize()
+	}
 	c.db.Close()
+	if c.tmpDir != "" {
+		os.RemoveAll(c.tmpDir)
+	}
 }
 
 func dbKey(dir string) ([]byte, error) {
@@ -0,0 +1,254 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package signal_test
+
+import (
+	"fmt"
+	"os"
+	"sort"
+	"testing"
+
+	"github.com/tbvdm/sigtop/signal"
+	"github.com/tbvdm/sigtop/signal/signaltest"
+)
+
+func TestGeneratedProfile(t *testing.T) {
+	for _, version := range []int{19, 20, 88} {
+		cfg := signaltest.DefaultConfig()
+		cfg.Version = version
+		cfg.Messages = 20
+		cfg.MentionRatio = 0.5
+		cfg.QuoteRatio = 0.5
+		cfg.ReactionRatio = 0.5
+		cfg.EditRatio = 0.5
+		cfg.AttachmentMaxSize = cfg.AttachmentMinSize
+		dir := signaltest.Profile(t, cfg)
+
+		ctx, err := signal.Open(dir)
+		if err != nil {
+			t.Fatalf("version %d: %v", version, err)
+		}
+
+		convs, err := ctx.Conversations()
+		if err != nil {
+			t.Fatalf("version %d: %v", version, err)
+		}
+		if len(convs) != cfg.Conversations {
+			t.Errorf("version %d: got %d conversations, want %d", version, len(convs), cfg.Conversations)
+		}
+		if !sort.SliceIsSorted(convs, func(i, j int) bool { return convs[i].ID < convs[j].ID }) {
+			t.Errorf("version %d: conversations not sorted by ID", version)
+		}
+
+		for _, conv := range convs {
+			msgs, err := ctx.ConversationMessages(&conv, signal.Interval{})
+			if err != nil {
+				t.Fatalf("version %d: %v", version, err)
+			}
+			if len(msgs) != cfg.Messages {
+				t.Errorf("version %d: got %d messages, want %d", version, len(msgs), cfg.Messages)
+			}
+			for _, msg := range msgs {
+				if msg.Conversation == nil {
+					t.Errorf("version %d: message without conversation", version)
+				}
+				for _, mnt := range msg.Body.Mentions {
+					if mnt.Recipient == nil {
+						t.Errorf("version %d: mention without recipient", version)
+					}
+				}
+				if msg.Quote != nil && msg.Quote.Recipient == nil {
+					t.Errorf("version %d: quote without recipient", version)
+				}
+				for _, att := range msg.Attachments {
+					if err := ctx.CheckAttachmentFile(&att); err != nil {
+						t.Errorf("version %d: %v", version, err)
+					}
+				}
+			}
+		}
+
+		ctx.Close()
+	}
+}
+
+func TestClone(t *testing.T) {
+	cfg := signaltest.DefaultConfig()
+	cfg.Messages = 20
+	dir := signaltest.Profile(t, cfg)
+
+	t.Run("private", func(t *testing.T) { testClone(t, signal.Open, dir, cfg) })
+	t.Run("shared", func(t *testing.T) { testClone(t, signal.OpenShared, dir, cfg) })
+}
+
+func testClone(t *testing.T, open func(string) (*signal.Context, error), dir string, cfg signaltest.Config) {
+	ctx, err := open(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ctx.Close()
+
+	convs, err := ctx.Conversations()
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// Read the messages of every conversation through several connections
+	// at once
+	const clones = 4
+	errs := make(chan error, clones)
+	for i := 0; i < clones; i++ {
+		go func() {
+			clone, err := ctx.Clone()
+			if err != nil {
+				errs <- err
+				return
+			}
+			defer clone.Close()
+			for _, conv := range convs {
+				msgs, err := clone.ConversationMessages(&conv, signal.Interval{})
+				if err != nil {
+					errs <- err
+					return
+				}
+				if len(msgs) != cfg.Messages {
+					errs <- fmt.Errorf("got %d messages, want %d", len(msgs), cfg.Messages)
+					return
+				}
+			}
+			errs <- nil
+		}()
+	}
+	for i := 0; i < clones; i++ {
+		if err := <-errs; err != nil {
+			t.Error(err)
+		}
+	}
+}
+
+func TestBeginRead(t *testing.T) {
+	cfg := signaltest.DefaultConfig()
+	cfg.Conversations = 1
+	cfg.Messages = 10
+	dir := signaltest.Profile(t, cfg)
+
+	ctx, err := signal.Open(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ctx.Close()
+
+	convs, err := ctx.Conversations()
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	countMessages := func() int {
+		msgs, err := ctx.ConversationMessages(&convs[0], signal.Interval{})
+		if err != nil {
+			t.Fatal(err)
+		}
+		return len(msgs)
+	}
+
+	if err := ctx.BeginRead(); err != nil {
+		t.Fatal(err)
+	}
+
+	// Add a message while the read transaction is active
+	db, err := signaltest.OpenDatabase(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer db.Close()
+	err = db.Exec("INSERT INTO messages (id, conversationId, type, json, sent_at, received_at) " +
+		"SELECT id || '-new', conversationId, type, json, sent_at, received_at FROM messages LIMIT 1")
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	if n := countMessages(); n != cfg.Messages {
+		t.Errorf("got %d messages during read transaction, want %d", n, cfg.Messages)
+	}
+
+	if err := ctx.EndRead(); err != nil {
+		t.Fatal(err)
+	}
+
+	if n := countMessages(); n != cfg.Messages+1 {
+		t.Errorf("got %d messages after read transaction, want %d", n, cfg.Messages+1)
+	}
+}
+
+func TestOpenSnapshot(t *testing.T) {
+	cfg := signaltest.DefaultConfig()
+	cfg.Conversations = 1
+	cfg.Messages = 10
+	dir := signaltest.Profile(t, cfg)
+
+	tmpDir := t.TempDir()
+
+	snapDir, err := os.MkdirTemp(tmpDir, "sigtop-")
+	if err != nil {
+		t.Fatal(err)
+	}
+	ctx, err := signal.OpenSnapshot(dir, snapDir)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// Add a message to the live database after the copy has been made
+	db, err := signaltest.OpenDatabase(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer db.Close()
+	err = db.Exec("INSERT INTO messages (id, conversationId, type, json, sent_at, received_at) " +
+		"SELECT id || '-new', conversationId, type, json, sent_at, received_at FROM messages LIMIT 1")
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	convs, err := ctx.Conversations()
+	if err != nil {
+		t.Fatal(err)
+	}
+	msgs, err := ctx.ConversationMessages(&convs[0], signal.Interval{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(msgs) != cfg.Messages {
+		t.Errorf("got %d messages, want %d", len(msgs), cfg.Messages)
+	}
+
+	// Attachments are still read from the Signal Desktop directory
+	for _, msg := range msgs {
+		for _, att := range msg.Attachments {
+			if err := ctx.CheckAttachmentFile(&att); err != nil {
+				t.Error(err)
+			}
+		}
+	}
+
+	ctx.Close()
+
+	entries, err := os.ReadDir(tmpDir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(entries) != 0 {
+		t.Errorf("temporary directory not removed: %s", entries[0].Name())
+	}
+}
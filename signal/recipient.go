@@ -15,18 +15,24 @@
 package signal
 
 import (
-	"encoding/json"
 	"fmt"
 	"strings"
 
 	"github.com/tbvdm/sigtop/sqlcipher"
+	"github.com/tbvdm/sigtop/stats"
 )
 
 const (
 	// For database version 19
 	recipientQuery19 = "SELECT "                     +
 		"id, "                                   +
-		"json, "                                 +
+		"json_extract(json, "                    +
+			"'$.profileAvatar.path') "       +
+			"AS profileAvatarPath, "         +
+		"json_extract(json, "                    +
+			"'$.avatar.path') "              +
+			"AS avatarPath, "                +
+		"active_at, "                            +
 		"type, "                                 +
 		"name, "                                 +
 		"profileName, "                          +
@@ -35,27 +41,39 @@ const (
 		"CASE type "                             +
 			"WHEN 'private' THEN '+' || id " +
 			"ELSE NULL "                     +
-		"END, "                                  + // e164
-		"NULL "                                  + // serviceId
+		"END AS e164, "                          +
+		"NULL AS serviceId "                     +
 		"FROM conversations"
 
 	// For database versions [20, 87]
 	recipientQuery20 = "SELECT "                     +
 		"id, "                                   +
-		"json, "                                 +
+		"json_extract(json, "                    +
+			"'$.profileAvatar.path') "       +
+			"AS profileAvatarPath, "         +
+		"json_extract(json, "                    +
+			"'$.avatar.path') "              +
+			"AS avatarPath, "                +
+		"active_at, "                            +
 		"type, "                                 +
 		"name, "                                 +
 		"profileName, "                          +
 		"profileFamilyName, "                    +
 		"profileFullName, "                      +
 		"e164, "                                 +
-		"uuid "                                  + // serviceId
+		"uuid AS serviceId "                     +
 		"FROM conversations"
 
 	// For database versions >= 88
 	recipientQuery88 = "SELECT "                     +
 		"id, "                                   +
-		"json, "                                 +
+		"json_extract(json, "                    +
+			"'$.profileAvatar.path') "       +
+			"AS profileAvatarPath, "         +
+		"json_extract(json, "                    +
+			"'$.avatar.path') "              +
+			"AS avatarPath, "                +
+		"active_at, "                            +
 		"type, "                                 +
 		"name, "                                 +
 		"profileName, "                          +
@@ -66,29 +84,18 @@ const (
 		"FROM conversations"
 )
 
-const (
-	recipientColumnID = iota
-	recipientColumnJSON
-	recipientColumnType
-	recipientColumnName
-	recipientColumnProfileName
-	recipientColumnProfileFamilyName
-	recipientColumnProfileFullName
-	recipientColumnE164
-	recipientColumnServiceID
-)
-
-// Based on ContactAvatarType in ts/types/Avatar.ts in the Signal-Desktop
-// repository
-type avatarJSON struct {
-	Path string `json:"path"`
-}
-
-// Based on ConversationAttributesType in ts/model-types.d.ts in the
-// Signal-Desktop repository
-type recipientJSON struct {
-	ProfileAvatar avatarJSON `json:"profileAvatar"` // For contacts
-	Avatar        avatarJSON `json:"avatar"`        // For groups
+type recipientRow struct {
+	ID                string `sql:"id"`
+	ProfileAvatarPath string `sql:"profileAvatarPath"` // For contacts
+	AvatarPath        string `sql:"avatarPath"`        // For groups
+	ActiveAt          int64  `sql:"active_at"`
+	Type              string `sql:"type"`
+	Name              string `sql:"name"`
+	ProfileName       string `sql:"profileName"`
+	ProfileFamilyName string `sql:"profileFamilyName"`
+	ProfileFullName   string `sql:"profileFullName"`
+	E164              string `sql:"e164"`
+	ServiceID         string `sql:"serviceId"`
 }
 
 type Recipient struct {
@@ -118,73 +125,93 @@ type Group struct {
 	Name string
 }
 
+func (c *Context) recipientQuery() string {
+	switch {
+	case c.dbVersion >= 88:
+		return recipientQuery88
+	case c.dbVersion >= 20:
+		return recipientQuery20
+	default:
+		return recipientQuery19
+	}
+}
+
+func (c *Context) initRecipientMaps() {
+	if c.recipientsByConversationID == nil {
+		c.recipientsByConversationID = make(map[string]*Recipient)
+		c.recipientsByPhone = make(map[string]*Recipient)
+		c.recipientsByACI = make(map[string]*Recipient)
+		c.activeAtByConversationID = make(map[string]int64)
+	}
+}
+
 func (c *Context) makeRecipientMaps() error {
-	if c.recipientsByConversationID != nil {
+	if c.recipientsLoaded {
 		// Nothing to do
 		return nil
 	}
 
-	c.recipientsByConversationID = make(map[string]*Recipient)
-	c.recipientsByPhone = make(map[string]*Recipient)
-	c.recipientsByACI = make(map[string]*Recipient)
+	c.initRecipientMaps()
 
-	var query string
-	switch {
-	case c.dbVersion >= 88:
-		query = recipientQuery88
-	case c.dbVersion >= 20:
-		query = recipientQuery20
-	default:
-		query = recipientQuery19
+	stmt, _, err := c.db.Prepare(c.recipientQuery())
+	if err != nil {
+		return err
 	}
 
-	stmt, _, err := c.db.Prepare(query)
+	rows, err := sqlcipher.Scan[recipientRow](stmt)
 	if err != nil {
+		stmt.Finalize()
 		return err
 	}
 
-	for stmt.Step() {
-		if err := c.addRecipient(stmt); err != nil {
+	var row recipientRow
+	for rows.Next() {
+		rows.Scan(&row)
+		if c.recipientsByConversationID[row.ID] != nil {
+			// Already added by a conversation lookup
+			continue
+		}
+		if _, err := c.addRecipient(&row); err != nil {
 			stmt.Finalize()
 			return err
 		}
 	}
 
-	return stmt.Finalize()
+	if err := stmt.Finalize(); err != nil {
+		return err
+	}
+
+	c.recipientsLoaded = true
+	return nil
 }
 
-func (c *Context) addRecipient(stmt *sqlcipher.Stmt) error {
+func (c *Context) addRecipient(row *recipientRow) (*Recipient, error) {
 	var r *Recipient
 
-	var jrpt recipientJSON
-	if err := json.Unmarshal([]byte(stmt.ColumnText(recipientColumnJSON)), &jrpt); err != nil {
-		return fmt.Errorf("cannot parse recipient JSON data: %w", err)
-	}
-
-	switch t := stmt.ColumnText(recipientColumnType); t {
+	switch t := row.Type; t {
 	case "private":
 		r = &Recipient{
 			Type: RecipientTypeContact,
 			Contact: Contact{
-				Name:              trimBidiChars(stmt.ColumnText(recipientColumnName)),
-				ProfileName:       stmt.ColumnText(recipientColumnProfileName),
-				ProfileFamilyName: stmt.ColumnText(recipientColumnProfileFamilyName),
-				ProfileJoinedName: stmt.ColumnText(recipientColumnProfileFullName),
-				Phone:             stmt.ColumnText(recipientColumnE164),
-				ACI:               stmt.ColumnText(recipientColumnServiceID),
+				Name:              c.intern(trimBidiChars(row.Name)),
+				ProfileName:       c.intern(row.ProfileName),
+				ProfileFamilyName: c.intern(row.ProfileFamilyName),
+				ProfileJoinedName: c.intern(row.ProfileFullName),
+				Phone:             row.E164,
+				ACI:               row.ServiceID,
 			},
-			AvatarPath: jrpt.ProfileAvatar.Path,
+			AvatarPath: row.ProfileAvatarPath,
 		}
 	case "group":
 		r = &Recipient{
 			Type: RecipientTypeGroup,
 			Group: Group{
-				Name: stmt.ColumnText(recipientColumnName),
+				Name: c.intern(row.Name),
 			},
-			AvatarPath: jrpt.Avatar.Path,
+			AvatarPath: row.AvatarPath,
 		}
 	default:
-		return fmt.Errorf("unknown recipient type: %q", t)
+		return nil, fmt.Errorf("unknown recipient type: %q", t)
 	}
 
 	if r.AvatarPath == SignalAvatarPath {
@@ -193,8 +220,8 @@ func (c *Context) addRecipient(stmt *sqlcipher.Stmt) error {
 		r.AvatarPath = ""
 	}
 
-	id := stmt.ColumnText(recipientColumnID)
-	c.recipientsByConversationID[id] = r
+	c.recipientsByConversationID[row.ID] = r
+	c.activeAtByConversationID[row.ID] = row.ActiveAt
 
 	if r.Type == RecipientTypeContact {
 		if r.Contact.Phone != "" {
@@ -205,7 +232,7 @@ func (c *Context) addRecipient(stmt *sqlcipher.Stmt) error {
 		}
 	}
 
-	return nil
+	return r, nil
 }
 
 // trimBidiChars removes one surrounding pair of FSI (U+2068) and PDI (U+2069)
@@ -218,25 +245,107 @@ func trimBidiChars(s string) string {
 	return s
 }
 
+// intern returns a string equal to s that shares its memory with earlier
+// strings equal to s. Recipient names are often repeated, for example in the
+// name and profile name of a contact.
+func (c *Context) intern(s string) string {
+	if s == "" {
+		return ""
+	}
+	if t, ok := c.internedStrings[s]; ok {
+		return t
+	}
+	if c.internedStrings == nil {
+		c.internedStrings = make(map[string]string)
+	}
+	c.internedStrings[s] = s
+	return s
+}
+
+// Recipients are loaded on demand, when they are first looked up. The maps
+// contain nil for recipients that were looked up but do not exist, so that
+// they are not looked up again.
+
+// Number of recipients loaded per query, to stay well below the limit on the
+// number of SQL parameters
+const recipientBatchSize = 500
+
+// loadRecipients loads the recipients with the specified conversation IDs that
+// have not been looked up yet, with one query per recipientBatchSize IDs
+func (c *Context) loadRecipients(ids []string) error {
+	if c.recipientsLoaded {
+		return nil
+	}
+
+	var missing []string
+	seen := make(map[string]bool)
+	for _, id := range ids {
+		if _, ok := c.recipientsByConversationID[id]; !ok && !seen[id] {
+			seen[id] = true
+			missing = append(missing, id)
+		}
+	}
+	if len(missing) == 0 {
+		return nil
+	}
+
+	for start := 0; start < len(missing); start += recipientBatchSize {
+		batch := missing[start:]
+		if len(batch) > recipientBatchSize {
+			batch = batch[:recipientBatchSize]
+		}
+		where := "id IN (?" + strings.Repeat(", ?", len(batch)-1) + ")"
+		if _, err := c.conversationsWhere(where, batch...); err != nil {
+			return err
+		}
+	}
+
+	for _, id := range missing {
+		if _, ok := c.recipientsByConversationID[id]; !ok {
+			c.recipientsByConversationID[id] = nil
+		}
+	}
+
+	return nil
+}
+
 func (c *Context) recipientFromConversationID(id string) (*Recipient, error) {
-	if err := c.makeRecipientMaps(); err != nil {
+	defer c.stats.Leave(c.stats.Enter(stats.Recipients))
+	if err := c.loadRecipients([]string{id}); err != nil {
 		return nil, err
 	}
 	return c.recipientsByConversationID[id], nil
 }
 
 func (c *Context) recipientFromPhone(phone string) (*Recipient, error) {
-	if err := c.makeRecipientMaps(); err != nil {
+	defer c.stats.Leave(c.stats.Enter(stats.Recipients))
+	if rpt, ok := c.recipientsByPhone[phone]; ok || c.recipientsLoaded {
+		return rpt, nil
+	}
+	if _, err := c.ConversationsByPhone(phone); err != nil {
 		return nil, err
 	}
+	if _, ok := c.recipientsByPhone[phone]; !ok {
+		c.initRecipientMaps()
+		c.recipientsByPhone[phone] = nil
+	}
 	return c.recipientsByPhone[phone], nil
 }
 
 func (c *Context) recipientFromACI(aci string) (*Recipient, error) {
-	if err := c.makeRecipientMaps(); err != nil {
+	defer c.stats.Leave(c.stats.Enter(stats.Recipients))
+	key := strings.ToLower(aci)
+	if rpt, ok := c.recipientsByACI[key]; ok || c.recipientsLoaded {
+		return rpt, nil
+	}
+	if _, err := c.conversationsByACI(aci); err != nil {
 		return nil, err
 	}
-	return c.recipientsByACI[strings.ToLower(aci)], nil
+	if _, ok := c.recipientsByACI[key]; !ok {
+		c.initRecipientMaps()
+		c.recipientsByACI[key] = nil
+	}
+	return c.recipientsByACI[key], nil
 }
 
 func (c *Context) AvatarPath(rpt *Recipient) string {
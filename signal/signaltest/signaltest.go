@@ -0,0 +1,524 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+// Package signaltest generates synthetic Signal Desktop profiles for tests and
+// benchmarks. A profile consists of an encrypted database, a configuration
+// file with the database key and a directory with attachment files. The
+// contents of a profile depend only on its configuration.
+package signaltest
+
+import (
+	"encoding/hex"
+	"encoding/json"
+	"errors"
+	"fmt"
+	"math/rand"
+	"os"
+	"path/filepath"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/tbvdm/sigtop/signal"
+	"github.com/tbvdm/sigtop/sqlcipher"
+)
+
+// Config describes a profile. Ratios are probabilities between 0 and 1.
+type Config struct {
+	// Database version. Versions 19, [20, 87] and >= 88 have different
+	// schemas.
+	Version int
+
+	Conversations int
+	// Fraction of conversations that are groups
+	GroupRatio float64
+	// Fraction of conversations with an avatar
+	AvatarRatio float64
+	// Number of messages per conversation
+	Messages int
+
+	// Fraction of messages with an attachment
+	AttachmentRatio   float64
+	AttachmentMinSize int
+	AttachmentMaxSize int
+
+	// Mentions are not generated for database version 19
+	MentionRatio  float64
+	QuoteRatio    float64
+	ReactionRatio float64
+	EditRatio     float64
+
+	// Seed for the random number generator
+	Seed int64
+}
+
+// DefaultConfig returns the configuration of a small profile with every kind
+// of data
+func DefaultConfig() Config {
+	return Config{
+		Version:           88,
+		Conversations:     10,
+		GroupRatio:        0.2,
+		AvatarRatio:       0.5,
+		Messages:          100,
+		AttachmentRatio:   0.1,
+		AttachmentMinSize: 1024,
+		AttachmentMaxSize: 64 * 1024,
+		MentionRatio:      0.05,
+		QuoteRatio:        0.05,
+		ReactionRatio:     0.1,
+		EditRatio:         0.02,
+		Seed:              1,
+	}
+}
+
+// Profile generates a profile in a temporary directory and returns the
+// directory. The directory is removed when the test finishes.
+func Profile(tb testing.TB, cfg Config) string {
+	tb.Helper()
+	dir := tb.TempDir()
+	if err := Generate(dir, cfg); err != nil {
+		tb.Fatal(err)
+	}
+	return dir
+}
+
+type contact struct {
+	id    string
+	phone string
+	aci   string
+}
+
+type generator struct {
+	cfg      Config
+	dir      string
+	rnd      *rand.Rand
+	db       *sqlcipher.DB
+	contacts []contact
+	time     int64
+	rowID    int64
+}
+
+// Generate generates a profile in dir, which must not contain a profile
+// already
+func Generate(dir string, cfg Config) error {
+	if cfg.Version < 19 {
+		return fmt.Errorf("database version %d not supported", cfg.Version)
+	}
+	if cfg.AttachmentMaxSize < cfg.AttachmentMinSize {
+		return errors.New("maximum attachment size less than minimum size")
+	}
+
+	g := generator{
+		cfg:  cfg,
+		dir:  dir,
+		rnd:  rand.New(rand.NewSource(cfg.Seed)),
+		time: time.Date(2020, 1, 1, 0, 0, 0, 0, time.UTC).UnixMilli(),
+	}
+
+	if err := os.MkdirAll(filepath.Join(dir, filepath.Dir(signal.DatabaseFile)), 0777); err != nil {
+		return err
+	}
+	if err := os.MkdirAll(filepath.Join(dir, signal.AttachmentDir), 0777); err != nil {
+		return err
+	}
+
+	key := make([]byte, 32)
+	g.rnd.Read(key)
+	if err := g.writeConfig(key); err != nil {
+		return err
+	}
+
+	var err error
+	if g.db, err = sqlcipher.Open(filepath.Join(dir, signal.DatabaseFile)); err != nil {
+		return err
+	}
+	defer g.db.Close()
+
+	if err := g.db.Key([]byte("x'" + hex.EncodeToString(key) + "'")); err != nil {
+		return err
+	}
+
+	// Like Signal Desktop
+	if err := g.db.Exec("PRAGMA journal_mode = WAL"); err != nil {
+		return err
+	}
+
+	if err := g.createSchema(); err != nil {
+		return err
+	}
+
+	if err := g.db.Exec("BEGIN TRANSACTION"); err != nil {
+		return err
+	}
+	if err := g.insertConversations(); err != nil {
+		return err
+	}
+	return g.db.Exec("COMMIT")
+}
+
+// OpenDatabase opens the database of the profile in dir for writing, as
+// Signal Desktop would
+func OpenDatabase(dir string) (*sqlcipher.DB, error) {
+	data, err := os.ReadFile(filepath.Join(dir, signal.ConfigFile))
+	if err != nil {
+		return nil, err
+	}
+	var config struct {
+		Key string `json:"key"`
+	}
+	if err := json.Unmarshal(data, &config); err != nil {
+		return nil, err
+	}
+
+	db, err := sqlcipher.Open(filepath.Join(dir, signal.DatabaseFile))
+	if err != nil {
+		return nil, err
+	}
+	if err := db.Key([]byte("x'" + config.Key + "'")); err != nil {
+		db.Close()
+		return nil, err
+	}
+	return db, nil
+}
+
+func (g *generator) writeConfig(key []byte) error {
+	data, err := json.Marshal(map[string]string{"key": hex.EncodeToString(key)})
+	if err != nil {
+		return err
+	}
+	return os.WriteFile(filepath.Join(g.dir, signal.ConfigFile), data, 0666)
+}
+
+func (g *generator) createSchema() error {
+	var convCols, msgSourceCol string
+	switch {
+	case g.cfg.Version >= 88:
+		convCols = "e164 TEXT, serviceId TEXT"
+		msgSourceCol = "sourceServiceId"
+	case g.cfg.Version >= 20:
+		convCols = "e164 TEXT, uuid TEXT"
+		msgSourceCol = "sourceUuid"
+	default:
+		msgSourceCol = "source"
+	}
+	if convCols != "" {
+		convCols = ", " + convCols
+	}
+
+	stmts := []string{
+		fmt.Sprintf("PRAGMA user_version = %d", g.cfg.Version),
+		"CREATE TABLE conversations (id TEXT PRIMARY KEY, json TEXT, active_at INTEGER, type TEXT, members TEXT, name TEXT, profileName TEXT, profileFamilyName TEXT, profileFullName TEXT" + convCols + ")",
+		"CREATE TABLE messages (rowid INTEGER PRIMARY KEY, id TEXT, json TEXT, conversationId TEXT, " + msgSourceCol + " TEXT, type TEXT, body TEXT, sent_at INTEGER, received_at INTEGER, hasAttachments INTEGER)",
+		"CREATE INDEX messages_conversation ON messages (conversationId, received_at)",
+	}
+	for _, stmt := range stmts {
+		if err := g.db.Exec(stmt); err != nil {
+			return err
+		}
+	}
+	return nil
+}
+
+func (g *generator) insertConversations() error {
+	nGroups := int(float64(g.cfg.Conversations) * g.cfg.GroupRatio)
+	nContacts := g.cfg.Conversations - nGroups
+
+	for i := 0; i < nContacts; i++ {
+		phone := fmt.Sprintf("+1555%07d", i)
+		c := contact{phone: phone, aci: g.uuid()}
+		if g.cfg.Version < 20 {
+			// Older databases use the phone number as the ID
+			c.id = phone[1:]
+		} else {
+			c.id = g.uuid()
+		}
+		g.contacts = append(g.contacts, c)
+	}
+
+	for i, c := range g.contacts {
+		jconv, err := g.conversationJSON("profileAvatar")
+		if err != nil {
+			return err
+		}
+		vals := []any{c.id, jconv, g.time, "private", nil, fmt.Sprintf("Contact %d", i), fmt.Sprintf("Profile %d", i), nil, fmt.Sprintf("Profile %d", i)}
+		if g.cfg.Version >= 20 {
+			vals = append(vals, c.phone, c.aci)
+		}
+		if err := g.insert("conversations", vals); err != nil {
+			return err
+		}
+	}
+
+	for i := 0; i < nGroups; i++ {
+		id := g.uuid()
+		jconv, err := g.conversationJSON("avatar")
+		if err != nil {
+			return err
+		}
+		vals := []any{id, jconv, g.time, "group", nil, fmt.Sprintf("Group %d", i), nil, nil, nil}
+		if g.cfg.Version >= 20 {
+			vals = append(vals, nil, nil)
+		}
+		if err := g.insert("conversations", vals); err != nil {
+			return err
+		}
+		if err := g.insertMessages(id, true); err != nil {
+			return err
+		}
+	}
+
+	for _, c := range g.contacts {
+		if err := g.insertMessages(c.id, false); err != nil {
+			return err
+		}
+	}
+
+	return nil
+}
+
+// conversationJSON returns the JSON data of a conversation. The avatar, if
+// any, is stored in the attribute with the specified name.
+func (g *generator) conversationJSON(avatarAttr string) (string, error) {
+	avatar := map[string]any{}
+	if g.chance(g.cfg.AvatarRatio) {
+		// Start with a PNG signature so that the file type is
+		// recognised
+		data := make([]byte, 4096+g.rnd.Intn(12*1024))
+		g.rnd.Read(data)
+		copy(data, "\x89PNG\r\n\x1a\n")
+		path, err := g.writeAttachmentFile(data)
+		if err != nil {
+			return "", err
+		}
+		avatar["path"] = path
+	}
+	data, err := json.Marshal(map[string]any{avatarAttr: avatar})
+	return string(data), err
+}
+
+func (g *generator) insert(table string, vals []any) error {
+	sql := "INSERT INTO " + table + " VALUES (?" + strings.Repeat(", ?", len(vals)-1) + ")"
+	stmt, _, err := g.db.Prepare(sql)
+	if err != nil {
+		return err
+	}
+	for i, val := range vals {
+		if err := stmt.Bind(i+1, val); err != nil {
+			stmt.Finalize()
+			return err
+		}
+	}
+	stmt.Step()
+	return stmt.Finalize()
+}
+
+func (g *generator) insertMessages(convID string, group bool) error {
+	stmt, _, err := g.db.Prepare("INSERT INTO messages VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?)")
+	if err != nil {
+		return err
+	}
+
+	var prevSent int64
+	for i := 0; i < g.cfg.Messages; i++ {
+		g.time += 1 + g.rnd.Int63n(60*60*1000)
+		g.rowID++
+
+		outgoing := g.rnd.Intn(2) == 0
+		var sender contact
+		if !outgoing && len(g.contacts) > 0 {
+			sender = g.contacts[g.rnd.Intn(len(g.contacts))]
+		}
+
+		jmsg, body, hasAtts, err := g.message(convID, sender, prevSent)
+		if err != nil {
+			stmt.Finalize()
+			return err
+		}
+
+		typ := "outgoing"
+		var source any
+		if !outgoing {
+			typ = "incoming"
+			switch {
+			case sender.id == "":
+			case g.cfg.Version >= 20:
+				source = sender.aci
+			default:
+				source = sender.id
+			}
+		}
+
+		vals := []any{g.rowID, g.uuid(), jmsg, convID, source, typ, body, g.time, g.time + 500, hasAtts}
+		for j, val := range vals {
+			if err := stmt.Bind(j+1, val); err != nil {
+				stmt.Finalize()
+				return err
+			}
+		}
+		stmt.Step()
+		if err := stmt.Reset(); err != nil {
+			stmt.Finalize()
+			return err
+		}
+		prevSent = g.time
+	}
+
+	return stmt.Finalize()
+}
+
+var words = strings.Fields("the quick brown fox jumps over the lazy dog lorem ipsum dolor sit amet consectetur adipiscing elit sed do eiusmod tempor")
+
+func (g *generator) text() string {
+	n := 1 + g.rnd.Intn(20)
+	w := make([]string, n)
+	for i := range w {
+		w[i] = words[g.rnd.Intn(len(words))]
+	}
+	return strings.Join(w, " ")
+}
+
+// message returns the JSON data and body of a message
+func (g *generator) message(convID string, sender contact, prevSent int64) (string, string, int, error) {
+	body := g.text()
+	jmsg := map[string]any{
+		"conversationId": convID,
+		"sent_at":        g.time,
+		"received_at_ms": g.time + 500,
+	}
+
+	// Database version 19 has no ACIs to refer to in a mention
+	if g.cfg.Version >= 20 && len(g.contacts) > 0 && g.chance(g.cfg.MentionRatio) {
+		// A mention replaces a placeholder character in the body
+		body = "\ufffc " + body
+		jmsg["bodyRanges"] = []any{g.mention(0)}
+	}
+	jmsg["body"] = body
+
+	hasAtts := 0
+	if g.chance(g.cfg.AttachmentRatio) {
+		att, err := g.attachment()
+		if err != nil {
+			return "", "", 0, err
+		}
+		jmsg["attachments"] = []any{att}
+		hasAtts = 1
+	}
+
+	if prevSent != 0 && len(g.contacts) > 0 && g.chance(g.cfg.QuoteRatio) {
+		author := g.contacts[g.rnd.Intn(len(g.contacts))]
+		quote := map[string]any{"id": prevSent, "text": g.text()}
+		switch {
+		case g.cfg.Version >= 88:
+			quote["authorAci"] = author.aci
+		case g.cfg.Version >= 20:
+			quote["authorUuid"] = author.aci
+		default:
+			quote["author"] = author.phone
+		}
+		jmsg["quote"] = quote
+	}
+
+	if len(g.contacts) > 0 && g.chance(g.cfg.ReactionRatio) {
+		from := g.contacts[g.rnd.Intn(len(g.contacts))]
+		fromID := from.id
+		if g.cfg.Version < 20 {
+			fromID = from.phone
+		}
+		jmsg["reactions"] = []any{map[string]any{
+			"emoji":           "\U0001f44d",
+			"fromId":          fromID,
+			"targetTimestamp": g.time,
+			"timestamp":       g.time + 1000,
+		}}
+	}
+
+	if g.chance(g.cfg.EditRatio) {
+		// The edit history includes the current version
+		jmsg["editHistory"] = []any{
+			map[string]any{"body": body, "timestamp": g.time + 2000},
+			map[string]any{"body": g.text(), "timestamp": g.time},
+		}
+	}
+
+	data, err := json.Marshal(jmsg)
+	if err != nil {
+		return "", "", 0, err
+	}
+	return string(data), body, hasAtts, nil
+}
+
+func (g *generator) mention(start int) map[string]any {
+	c := g.contacts[g.rnd.Intn(len(g.contacts))]
+	mnt := map[string]any{"start": start, "length": 1}
+	if g.cfg.Version >= 88 {
+		mnt["mentionAci"] = c.aci
+	} else {
+		mnt["mentionUuid"] = c.aci
+	}
+	return mnt
+}
+
+// attachment writes an attachment file and returns its JSON data
+func (g *generator) attachment() (map[string]any, error) {
+	size := g.cfg.AttachmentMinSize
+	if n := g.cfg.AttachmentMaxSize - g.cfg.AttachmentMinSize; n > 0 {
+		size += g.rnd.Intn(n + 1)
+	}
+	data := make([]byte, size)
+	g.rnd.Read(data)
+
+	path, err := g.writeAttachmentFile(data)
+	if err != nil {
+		return nil, err
+	}
+
+	return map[string]any{
+		"contentType": "application/octet-stream",
+		"fileName":    fmt.Sprintf("file-%s.bin", path[3:11]),
+		"size":        size,
+		"path":        path,
+	}, nil
+}
+
+// writeAttachmentFile writes data to a new file in the attachment directory
+// and returns its path relative to that directory
+func (g *generator) writeAttachmentFile(data []byte) (string, error) {
+	name := make([]byte, 32)
+	g.rnd.Read(name)
+	id := hex.EncodeToString(name)
+
+	dir := filepath.Join(g.dir, signal.AttachmentDir, id[:2])
+	if err := os.MkdirAll(dir, 0777); err != nil {
+		return "", err
+	}
+	if err := os.WriteFile(filepath.Join(dir, id), data, 0666); err != nil {
+		return "", err
+	}
+
+	return id[:2] + "/" + id, nil
+}
+
+func (g *generator) chance(p float64) bool {
+	return p > 0 && g.rnd.Float64() < p
+}
+
+func (g *generator) uuid() string {
+	b := make([]byte, 16)
+	g.rnd.Read(b)
+	b[6] = b[6]&0x0f | 0x40
+	b[8] = b[8]&0x3f | 0x80
+	h := hex.EncodeToString(b)
+	return h[:8] + "-" + h[8:12] + "-" + h[12:16] + "-" + h[16:20] + "-" + h[20:]
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package signal
+
+import (
+	"os"
+	"path/filepath"
+
+	"github.com/tbvdm/sigtop/sqlcipher"
+)
+
+// OpenSnapshot copies the database in the Signal Desktop directory dir to the
+// empty temporary directory tmpDir and opens the copy. The live database is
+// only read while it is being copied, so that a long export does not keep
+// Signal Desktop from checkpointing its write-ahead log. The copy is encrypted
+// with the same key as the live database. Attachments and avatars are still
+// read from dir.
+//
+// The caller creates tmpDir, so that it can arrange for its removal should the
+// process be interrupted while the database is being copied. Otherwise,
+// tmpDir is removed when the context is closed, or when OpenSnapshot fails.
+func OpenSnapshot(dir, tmpDir string) (*Context, error) {
+	return openSnapshot(dir, tmpDir, false)
+}
+
+// OpenSnapshotShared is like OpenSnapshot, but opens the copy in shared-cache
+// mode, as OpenShared does
+func OpenSnapshotShared(dir, tmpDir string) (*Context, error) {
+	return openSnapshot(dir, tmpDir, true)
+}
+
+func openSnapshot(dir, tmpDir string, shared bool) (*Context, error) {
+	live, err := Open(dir)
+	if err != nil {
+		os.RemoveAll(tmpDir)
+		return nil, err
+	}
+	defer live.Close()
+
+	dbFile := filepath.Join(tmpDir, filepath.Base(DatabaseFile))
+	if err := live.copyDatabase(dbFile); err != nil {
+		os.RemoveAll(tmpDir)
+		return nil, err
+	}
+
+	ctx, err := open(dir, dbFile, shared)
+	if err != nil {
+		os.RemoveAll(tmpDir)
+		return nil, err
+	}
+	ctx.tmpDir = tmpDir
+
+	return ctx, nil
+}
+
+// copyDatabase copies the database of c to a new database file at path. The
+// pages are copied with the backup API, which reads a consistent snapshot of
+// the database, including the contents of the write-ahead log.
+func (c *Context) copyDatabase(path string) error {
+	db, err := sqlcipher.Open(path)
+	if err != nil {
+		return err
+	}
+	defer db.Close()
+
+	key, err := dbKey(c.dir)
+	if err != nil {
+		return err
+	}
+	if err := db.Key(key); err != nil {
+		return err
+	}
+
+	backup, err := sqlcipher.NewBackup(db, "main", c.db, "main")
+	if err != nil {
+		return err
+	}
+	backup.Step(-1)
+	return backup.Finish()
+}
@@ -0,0 +1,176 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package signal
+
+import (
+	"strings"
+
+	"github.com/tbvdm/sigtop/sqlcipher"
+)
+
+const (
+	summarySelect = "SELECT " +
+		"conversationId, " +
+		"count(*) AS messages, " +
+		"ifnull(sum(hasAttachments), 0) AS attachments, " +
+		"min(sent_at) AS firstSent, " +
+		"max(sent_at) AS lastSent " +
+		"FROM messages "
+
+	summaryGroup = " GROUP BY conversationId"
+
+	summaryWhereSentBefore  = "(sent_at <= ? OR sent_at IS NULL)"
+	summaryWhereSentAfter   = "sent_at >= ?"
+	summaryWhereSentBetween = "sent_at BETWEEN ? AND ?"
+)
+
+// Summaries are restricted to specific conversations only if there are not
+// too many of them. Otherwise, a single pass over the messages table is
+// cheaper than an index lookup per conversation, and the number of
+// conversation IDs could exceed the limit on the number of SQL parameters.
+const maxSummaryIDs = 500
+
+type summaryRow struct {
+	ConversationID sqlcipher.NullString `sql:"conversationId"`
+	Messages       int                  `sql:"messages"`
+	Attachments    int                  `sql:"attachments"`
+	FirstSent      sqlcipher.NullInt64  `sql:"firstSent"`
+	LastSent       sqlcipher.NullInt64  `sql:"lastSent"`
+}
+
+// ConversationSummary summarises the messages of a conversation in a time
+// interval
+type ConversationSummary struct {
+	Messages    int   // Number of messages
+	Attachments int   // Estimated number of messages with attachments
+	FirstSent   int64 // Time the first message was sent
+	LastSent    int64 // Time the last message was sent
+}
+
+// ConversationSummaries returns a summary of the messages sent in the interval
+// ival for every conversation that has such messages. If ids is not nil, only
+// the conversations with these IDs are summarised. The number of messages
+// with attachments is taken from the hasAttachments column, which Signal
+// Desktop does not set for all kinds of attachments, so it is only an
+// estimate. The summaries are computed with a single query over the messages
+// table, which is much cheaper than querying the messages of every
+// conversation. Subsequent calls to ConversationMessages with the same
+// interval use the summaries to size their results.
+func (c *Context) ConversationSummaries(ival Interval, ids []string) (map[string]ConversationSummary, error) {
+	if len(ids) > maxSummaryIDs {
+		ids = nil
+	}
+
+	stmt, err := c.summaryStmt(ival, ids)
+	if err != nil {
+		return nil, err
+	}
+
+	rows, err := sqlcipher.Scan[summaryRow](stmt)
+	if err != nil {
+		stmt.Finalize()
+		return nil, err
+	}
+
+	sums := make(map[string]ConversationSummary)
+	var row summaryRow
+	for nextRow(c, rows) {
+		rows.Scan(&row)
+		if !row.ConversationID.Valid {
+			continue
+		}
+		sums[row.ConversationID.String] = ConversationSummary{
+			Messages:    row.Messages,
+			Attachments: row.Attachments,
+			FirstSent:   row.FirstSent.Int64,
+			LastSent:    row.LastSent.Int64,
+		}
+	}
+
+	if err := stmt.Finalize(); err != nil {
+		return nil, err
+	}
+
+	c.summaries = sums
+	c.summaryIval = ival
+	c.summaryIDs = nil
+	if ids != nil {
+		c.summaryIDs = make(map[string]bool, len(ids))
+		for _, id := range ids {
+			c.summaryIDs[id] = true
+		}
+	}
+	return sums, nil
+}
+
+func (c *Context) summaryStmt(ival Interval, ids []string) (*sqlcipher.Stmt, error) {
+	var where []string
+	var args []any
+
+	if ids != nil {
+		if len(ids) == 0 {
+			where = append(where, "0")
+		} else {
+			where = append(where, "conversationId IN (?"+strings.Repeat(", ?", len(ids)-1)+")")
+			for _, id := range ids {
+				args = append(args, id)
+			}
+		}
+	}
+
+	switch {
+	case ival.Min.IsZero() && ival.Max.IsZero():
+	case ival.Min.IsZero():
+		where = append(where, summaryWhereSentBefore)
+		args = append(args, ival.Max.UnixMilli())
+	case ival.Max.IsZero():
+		where = append(where, summaryWhereSentAfter)
+		args = append(args, ival.Min.UnixMilli())
+	default:
+		where = append(where, summaryWhereSentBetween)
+		args = append(args, ival.Min.UnixMilli(), ival.Max.UnixMilli())
+	}
+
+	query := summarySelect
+	if where != nil {
+		query += "WHERE " + strings.Join(where, " AND ")
+	}
+	query += summaryGroup
+
+	stmt, _, err := c.db.Prepare(query)
+	if err != nil {
+		return nil, err
+	}
+	for i, arg := range args {
+		if err := stmt.Bind(i+1, arg); err != nil {
+			stmt.Finalize()
+			return nil, err
+		}
+	}
+	return stmt, nil
+}
+
+// summary returns the summary of the conversation with the specified ID for
+// the interval ival, if ConversationSummaries has summarised that conversation
+// for that interval
+func (c *Context) summary(id string, ival Interval) (ConversationSummary, bool) {
+	if c.summaries == nil || !c.summaryIval.Min.Equal(ival.Min) || !c.summaryIval.Max.Equal(ival.Max) {
+		return ConversationSummary{}, false
+	}
+	if c.summaryIDs != nil && !c.summaryIDs[id] {
+		return ConversationSummary{}, false
+	}
+	return c.summaries[id], true
+}
@@ -0,0 +1,187 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package signal_test
+
+import (
+	"testing"
+	"time"
+
+	"github.com/tbvdm/sigtop/signal"
+	"github.com/tbvdm/sigtop/signal/signaltest"
+)
+
+func TestConversationSummaries(t *testing.T) {
+	cfg := signaltest.DefaultConfig()
+	cfg.Messages = 20
+	dir := signaltest.Profile(t, cfg)
+
+	ctx, err := signal.Open(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ctx.Close()
+
+	convs, err := ctx.Conversations()
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	// Split the messages of the first conversation in two halves
+	msgs, err := ctx.ConversationMessages(&convs[0], signal.Interval{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	mid := time.UnixMilli(msgs[len(msgs)/2].TimeSent)
+
+	ivals := []signal.Interval{
+		{},
+		{Max: mid},
+		{Min: mid},
+		{Min: mid, Max: mid.Add(24 * time.Hour)},
+	}
+
+	for _, ival := range ivals {
+		// Query the messages without summaries first
+		want := make(map[string][]signal.Message)
+		for _, conv := range convs {
+			msgs, err := ctx.ConversationMessages(&conv, ival)
+			if err != nil {
+				t.Fatal(err)
+			}
+			if len(msgs) > 0 {
+				want[conv.ID] = msgs
+			}
+		}
+
+		sums, err := ctx.ConversationSummaries(ival, nil)
+		if err != nil {
+			t.Fatal(err)
+		}
+		if len(sums) != len(want) {
+			t.Errorf("%v: got %d summaries, want %d", ival, len(sums), len(want))
+		}
+
+		for _, conv := range convs {
+			sum := sums[conv.ID]
+			msgs := want[conv.ID]
+			if sum.Messages != len(msgs) {
+				t.Errorf("%v: got %d messages, want %d", ival, sum.Messages, len(msgs))
+				continue
+			}
+			if len(msgs) == 0 {
+				continue
+			}
+			atts := 0
+			for _, msg := range msgs {
+				if len(msg.Attachments) > 0 {
+					atts++
+				}
+			}
+			if sum.Attachments != atts {
+				t.Errorf("%v: got %d messages with attachments, want %d", ival, sum.Attachments, atts)
+			}
+			if sum.FirstSent != msgs[0].TimeSent || sum.LastSent != msgs[len(msgs)-1].TimeSent {
+				t.Errorf("%v: got time range [%d, %d], want [%d, %d]", ival, sum.FirstSent, sum.LastSent, msgs[0].TimeSent, msgs[len(msgs)-1].TimeSent)
+			}
+
+			// The messages must be the same with the summaries
+			// available
+			got, err := ctx.ConversationMessages(&conv, ival)
+			if err != nil {
+				t.Fatal(err)
+			}
+			if len(got) != len(msgs) {
+				t.Errorf("%v: got %d messages with summaries, want %d", ival, len(got), len(msgs))
+			}
+		}
+	}
+}
+
+func TestSummaryWithoutAttachmentFlag(t *testing.T) {
+	cfg := signaltest.DefaultConfig()
+	cfg.Conversations = 1
+	cfg.Messages = 20
+	cfg.AttachmentRatio = 1
+	dir := signaltest.Profile(t, cfg)
+
+	// Signal Desktop does not set hasAttachments for all attachments
+	db, err := signaltest.OpenDatabase(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	err = db.Exec("UPDATE messages SET hasAttachments = NULL")
+	db.Close()
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	ctx, err := signal.Open(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ctx.Close()
+
+	convs, err := ctx.Conversations()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if _, err := ctx.ConversationSummaries(signal.Interval{}, nil); err != nil {
+		t.Fatal(err)
+	}
+	atts, err := ctx.ConversationAttachments(&convs[0], signal.Interval{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(atts) == 0 {
+		t.Error("attachments skipped")
+	}
+}
+
+func TestConversationSummariesSubset(t *testing.T) {
+	cfg := signaltest.DefaultConfig()
+	cfg.Messages = 20
+	dir := signaltest.Profile(t, cfg)
+
+	ctx, err := signal.Open(dir)
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer ctx.Close()
+
+	convs, err := ctx.Conversations()
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(convs) < 2 {
+		t.Fatal("need at least two conversations")
+	}
+
+	sums, err := ctx.ConversationSummaries(signal.Interval{}, []string{convs[0].ID})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(sums) != 1 || sums[convs[0].ID].Messages != cfg.Messages {
+		t.Errorf("got summaries %v, want only %s with %d messages", sums, convs[0].ID, cfg.Messages)
+	}
+
+	// Conversations that were not summarised must not be taken to be empty
+	msgs, err := ctx.ConversationMessages(&convs[1], signal.Interval{})
+	if err != nil {
+		t.Fatal(err)
+	}
+	if len(msgs) != cfg.Messages {
+		t.Errorf("got %d messages, want %d", len(msgs), cfg.Messages)
+	}
+}
@@ -0,0 +1,40 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package signal
+
+import (
+	"fmt"
+	"io"
+	"strings"
+
+	"github.com/tbvdm/sigtop/sqlcipher"
+)
+
+var traceWriter io.Writer
+
+// SetTrace enables statement tracing for contexts opened afterwards. For every
+// executed statement, a line with its duration, number of rows, statement
+// counters and SQL is written to w. Tracing is disabled if w is nil.
+func SetTrace(w io.Writer) {
+	traceWriter = w
+}
+
+func traceStatement(w io.Writer) func(*sqlcipher.TraceInfo) {
+	return func(info *sqlcipher.TraceInfo) {
+		// Write the SQL on a single line
+		sql := strings.Join(strings.Fields(info.SQL), " ")
+		fmt.Fprintf(w, "%v rows=%d vmsteps=%d fullscan=%d sort=%d autoindex=%d %s\n", info.Duration, info.Rows, info.VMSteps, info.FullscanSteps, info.Sorts, info.AutoIndexes, sql)
+	}
+}
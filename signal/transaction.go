@@ -0,0 +1,46 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package signal
+
+import "fmt"
+
+// BeginRead starts a read transaction. Until EndRead is called, all queries
+// on c see the database as it was when BeginRead was called, even if Signal
+// Desktop writes to it in the meantime. The clones of c share the transaction,
+// because they share its page cache.
+func (c *Context) BeginRead() error {
+	if err := c.db.Exec("BEGIN"); err != nil {
+		return fmt.Errorf("cannot begin read transaction: %w", err)
+	}
+
+	// BEGIN does not start the transaction until the database is read
+	if err := c.db.Exec("SELECT count(*) FROM sqlite_master"); err != nil {
+		c.db.Exec("ROLLBACK")
+		return fmt.Errorf("cannot begin read transaction: %w", err)
+	}
+
+	return nil
+}
+
+// EndRead ends the read transaction started by BeginRead
+func (c *Context) EndRead() error {
+	// The summaries may be out of date once the transaction has ended
+	c.summaries = nil
+
+	if err := c.db.Exec("COMMIT"); err != nil {
+		return fmt.Errorf("cannot end read transaction: %w", err)
+	}
+	return nil
+}
@@ -0,0 +1,306 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package sqlcipher
+
+// #include <string.h>
+//
+// #include "sqlite3.h"
+//
+// struct sqlcipher_value {
+// 	sqlite3_int64	 i;	/* Integer value or offset of text or blob */
+// 	double		 f;	/* Float value; its text is stored as well */
+// 	int		 type;
+// 	int		 len;
+// };
+//
+// /*
+//  * Copy the current row of stmt into vals and data, starting at offset
+//  * *off in data. Return SQLITE_OK if the row was copied, SQLITE_FULL if it
+//  * does not fit in data, or another error code if an error occurred. If
+//  * the row does not fit, *need is set to the size that is needed.
+//  */
+// static int
+// sqlcipher_copy_row(sqlite3_stmt *stmt, int ncols,
+//     struct sqlcipher_value *vals, unsigned char *data, int datasize,
+//     int *off, int *need)
+// {
+// 	const void	*p;
+// 	int		 i, len, o;
+//
+// 	o = *off;
+// 	for (i = 0; i < ncols; i++) {
+// 		vals[i].type = sqlite3_column_type(stmt, i);
+// 		vals[i].len = 0;
+// 		switch (vals[i].type) {
+// 		case SQLITE_INTEGER:
+// 			vals[i].i = sqlite3_column_int64(stmt, i);
+// 			break;
+// 		case SQLITE_FLOAT:
+// 		case SQLITE_TEXT:
+// 		case SQLITE_BLOB:
+// 			/* Let SQLite convert floats to text */
+// 			if (vals[i].type == SQLITE_FLOAT)
+// 				vals[i].f = sqlite3_column_double(stmt, i);
+// 			if (vals[i].type != SQLITE_BLOB)
+// 				p = sqlite3_column_text(stmt, i);
+// 			else
+// 				p = sqlite3_column_blob(stmt, i);
+// 			len = sqlite3_column_bytes(stmt, i);
+// 			if (p == NULL && len > 0)
+// 				return SQLITE_NOMEM;
+// 			if (p == NULL &&
+// 			    sqlite3_errcode(sqlite3_db_handle(stmt)) == SQLITE_NOMEM)
+// 				return SQLITE_NOMEM;
+// 			if (len > datasize - o) {
+// 				/* Compute the size needed for the whole row */
+// 				for (*need = o - *off; i < ncols; i++)
+// 					*need += sqlite3_column_bytes(stmt, i);
+// 				return SQLITE_FULL;
+// 			}
+// 			if (len > 0)
+// 				memcpy(data + o, p, len);
+// 			vals[i].i = o;
+// 			vals[i].len = len;
+// 			o += len;
+// 			break;
+// 		}
+// 	}
+// 	*off = o;
+// 	return SQLITE_OK;
+// }
+//
+// /*
+//  * Step stmt up to maxrows times and copy the rows into vals and data. If
+//  * pending is set, the current row is copied first. Return SQLITE_ROW if
+//  * more rows may follow, SQLITE_DONE if there are no more rows, SQLITE_FULL
+//  * if the first row does not fit in data, or another error code if an error
+//  * occurred. If a row does not fit in data, it is left pending and *pending
+//  * is set.
+//  */
+// static int
+// sqlcipher_fetch_batch(sqlite3_stmt *stmt, int *pending, int maxrows,
+//     int ncols, struct sqlcipher_value *vals, unsigned char *data,
+//     int datasize, int *nrows, int *need)
+// {
+// 	int ret, off;
+//
+// 	*nrows = 0;
+// 	off = 0;
+// 	while (*nrows < maxrows) {
+// 		if (!*pending) {
+// 			if ((ret = sqlite3_step(stmt)) != SQLITE_ROW)
+// 				return ret;
+// 			*pending = 1;
+// 		}
+// 		ret = sqlcipher_copy_row(stmt, ncols, vals + *nrows * ncols,
+// 		    data, datasize, &off, need);
+// 		if (ret == SQLITE_FULL && *nrows > 0)
+// 			return SQLITE_ROW;
+// 		if (ret != SQLITE_OK)
+// 			return ret;
+// 		*pending = 0;
+// 		(*nrows)++;
+// 	}
+// 	return SQLITE_ROW;
+// }
+import "C"
+
+import (
+	"strconv"
+	"unsafe"
+)
+
+const minBatchDataSize = 64 * 1024
+
+// Batch holds rows fetched with FetchBatch. Text and blob values are stored
+// in a single buffer that is reused by subsequent calls to FetchBatch.
+type Batch struct {
+	stmt    *Stmt
+	cols    int
+	rows    int
+	vals    []C.struct_sqlcipher_value
+	data    []byte
+	pending bool
+	done    bool
+}
+
+// FetchBatch steps s up to n times and stores the resulting rows in b. A
+// single call into C fetches the whole batch, which avoids the overhead of a
+// cgo call for every step and every column. FetchBatch reports whether any
+// rows were fetched. Like Step, it returns false if an error occurred; the
+// error is returned by Finalize or Reset.
+//
+// A batch can be reused for another statement. To reuse it for the same
+// statement after the statement has been reset, call b.Reset first.
+func (s *Stmt) FetchBatch(n int, b *Batch) bool {
+	if b.stmt != s {
+		b.Reset()
+		b.stmt = s
+		b.cols = s.ColumnCount()
+	}
+
+	b.rows = 0
+	if b.done || n <= 0 {
+		return false
+	}
+
+	size := n * b.cols
+	if size == 0 {
+		size = 1
+	}
+	if len(b.vals) < size {
+		b.vals = make([]C.struct_sqlcipher_value, size)
+	}
+	if b.data == nil {
+		b.data = make([]byte, minBatchDataSize)
+	}
+
+	for {
+		var nrows, need C.int
+		pending := C.int(0)
+		if b.pending {
+			pending = 1
+		}
+
+		ret := C.sqlcipher_fetch_batch(s.stmt, &pending, C.int(n), C.int(b.cols), &b.vals[0], (*C.uchar)(unsafe.Pointer(&b.data[0])), C.int(len(b.data)), &nrows, &need)
+		b.rows = int(nrows)
+		b.pending = pending != 0
+
+		switch ret {
+		case C.SQLITE_ROW:
+			return true
+		case C.SQLITE_DONE:
+			b.done = true
+			return b.rows > 0
+		case C.SQLITE_FULL:
+			// The first row does not fit; grow the buffer and
+			// try again
+			size := 2 * len(b.data)
+			if int(need) > size {
+				size = int(need)
+			}
+			b.data = make([]byte, size)
+		default:
+			s.err = s.db.errorf("cannot execute SQL statement")
+			b.done = true
+			return false
+		}
+	}
+}
+
+// Reset prepares b for a new execution of a statement. The buffers of b are
+// kept.
+func (b *Batch) Reset() {
+	b.stmt = nil
+	b.rows = 0
+	b.pending = false
+	b.done = false
+}
+
+// Len returns the number of rows in b
+func (b *Batch) Len() int {
+	return b.rows
+}
+
+func (b *Batch) value(row, col int) *C.struct_sqlcipher_value {
+	if row < 0 || row >= b.rows || col < 0 || col >= b.cols {
+		panic("sqlite: batch index out of range")
+	}
+	return &b.vals[row*b.cols+col]
+}
+
+func (b *Batch) bytes(v *C.struct_sqlcipher_value) []byte {
+	return b.data[v.i : v.i+C.sqlite3_int64(v.len)]
+}
+
+func (b *Batch) ColumnType(row, col int) ColumnType {
+	switch t := b.value(row, col)._type; t {
+	case C.SQLITE_INTEGER:
+		return ColumnTypeInteger
+	case C.SQLITE_FLOAT:
+		return ColumnTypeFloat
+	case C.SQLITE_TEXT:
+		return ColumnTypeText
+	case C.SQLITE_BLOB:
+		return ColumnTypeBlob
+	default:
+		return ColumnTypeNull
+	}
+}
+
+// ColumnInt64 returns an integer value. Other values are converted like
+// SQLite does for well-formed values.
+func (b *Batch) ColumnInt64(row, col int) int64 {
+	v := b.value(row, col)
+	switch v._type {
+	case C.SQLITE_INTEGER:
+		return int64(v.i)
+	case C.SQLITE_FLOAT:
+		return int64(v.f)
+	case C.SQLITE_TEXT, C.SQLITE_BLOB:
+		i, _ := strconv.ParseInt(string(b.bytes(v)), 10, 64)
+		return i
+	default:
+		return 0
+	}
+}
+
+func (b *Batch) ColumnInt(row, col int) int {
+	return int(b.ColumnInt64(row, col))
+}
+
+// ColumnDouble returns a floating-point value. Other values are converted
+// like SQLite does for well-formed values.
+func (b *Batch) ColumnDouble(row, col int) float64 {
+	v := b.value(row, col)
+	switch v._type {
+	case C.SQLITE_INTEGER:
+		return float64(v.i)
+	case C.SQLITE_FLOAT:
+		return float64(v.f)
+	case C.SQLITE_TEXT, C.SQLITE_BLOB:
+		f, _ := strconv.ParseFloat(string(b.bytes(v)), 64)
+		return f
+	default:
+		return 0
+	}
+}
+
+// ColumnText returns a text value. Other values are converted like SQLite
+// does.
+func (b *Batch) ColumnText(row, col int) string {
+	v := b.value(row, col)
+	switch v._type {
+	case C.SQLITE_INTEGER:
+		return strconv.FormatInt(int64(v.i), 10)
+	case C.SQLITE_FLOAT, C.SQLITE_TEXT, C.SQLITE_BLOB:
+		return string(b.bytes(v))
+	default:
+		return ""
+	}
+}
+
+// ColumnBlob returns a copy of a blob value
+func (b *Batch) ColumnBlob(row, col int) []byte {
+	v := b.value(row, col)
+	switch v._type {
+	case C.SQLITE_TEXT, C.SQLITE_BLOB:
+		return append([]byte(nil), b.bytes(v)...)
+	case C.SQLITE_NULL:
+		return nil
+	default:
+		return []byte(b.ColumnText(row, col))
+	}
+}
@@ -0,0 +1,153 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package sqlcipher
+
+import (
+	"fmt"
+	"strings"
+	"testing"
+)
+
+func TestFetchBatch(t *testing.T) {
+	db, err := Open(":memory:")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer db.Close()
+
+	// Rows with values of every type and text of increasing length
+	const rows = 100
+	err = db.Execf("CREATE TABLE t (i INTEGER, f REAL, s TEXT, b BLOB, n); "+
+		"WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < %d) "+
+		"INSERT INTO t SELECT i, i / 2.0, printf('%%.*c', i, 'x'), zeroblob(i %% 3), NULL FROM n", rows)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	for _, dataSize := range []int{1, 50, 1000, minBatchDataSize} {
+		for _, n := range []int{1, 7, rows, 2 * rows} {
+			stmt, _, err := db.Prepare("SELECT i, f, s, b, n FROM t ORDER BY i")
+			if err != nil {
+				t.Fatal(err)
+			}
+
+			// Start with a small buffer to exercise rows that do
+			// not fit
+			b := Batch{data: make([]byte, dataSize)}
+			i := 0
+			for stmt.FetchBatch(n, &b) {
+				if b.Len() == 0 || b.Len() > n {
+					t.Errorf("size %d, n %d: got batch of %d rows", dataSize, n, b.Len())
+				}
+				for row := 0; row < b.Len(); row++ {
+					i++
+					if got := b.ColumnInt64(row, 0); got != int64(i) {
+						t.Errorf("size %d, n %d: got integer %d, want %d", dataSize, n, got, i)
+					}
+					if got, want := b.ColumnDouble(row, 1), float64(i)/2; got != want {
+						t.Errorf("size %d, n %d: got float %v, want %v", dataSize, n, got, want)
+					}
+					if got, want := b.ColumnText(row, 2), strings.Repeat("x", i); got != want {
+						t.Errorf("size %d, n %d: got text %q, want %q", dataSize, n, got, want)
+					}
+					if got, want := len(b.ColumnBlob(row, 3)), i%3; got != want {
+						t.Errorf("size %d, n %d: got blob of length %d, want %d", dataSize, n, got, want)
+					}
+					if got := b.ColumnType(row, 4); got != ColumnTypeNull {
+						t.Errorf("size %d, n %d: got column type %d, want null", dataSize, n, got)
+					}
+					if got := b.ColumnText(row, 0); got != fmt.Sprint(i) {
+						t.Errorf("size %d, n %d: got text %q, want %q", dataSize, n, got, fmt.Sprint(i))
+					}
+				}
+			}
+			if err := stmt.Finalize(); err != nil {
+				t.Fatal(err)
+			}
+			if i != rows {
+				t.Errorf("size %d, n %d: got %d rows, want %d", dataSize, n, i, rows)
+			}
+		}
+	}
+}
+
+func TestBatchColumnText(t *testing.T) {
+	db, err := Open(":memory:")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer db.Close()
+
+	// Floats must be converted to text the same way on both fetch paths
+	const query = "SELECT 0.1 + 0.2, 1e15, 1.0 / 3, 100.0, 9e999, -9e999, 1e-5"
+
+	stmt, _, err := db.Prepare(query)
+	if err != nil {
+		t.Fatal(err)
+	}
+	if !stmt.Step() {
+		t.Fatal(stmt.Finalize())
+	}
+	var want []string
+	for i := 0; i < stmt.ColumnCount(); i++ {
+		want = append(want, stmt.ColumnText(i))
+	}
+	if err := stmt.Finalize(); err != nil {
+		t.Fatal(err)
+	}
+
+	if stmt, _, err = db.Prepare(query); err != nil {
+		t.Fatal(err)
+	}
+	var b Batch
+	if !stmt.FetchBatch(1, &b) {
+		t.Fatal(stmt.Finalize())
+	}
+	for i := range want {
+		if got := b.ColumnText(0, i); got != want[i] {
+			t.Errorf("column %d: got %q, want %q", i, got, want[i])
+		}
+		if got := b.ColumnType(0, i); got != ColumnTypeFloat {
+			t.Errorf("column %d: got type %v, want float", i, got)
+		}
+	}
+	if err := stmt.Finalize(); err != nil {
+		t.Fatal(err)
+	}
+
+	// The second row does not fit in the buffer, so it is copied again by
+	// the next call, after its float has already been converted to text
+	stmt, _, err = db.Prepare("WITH t(n) AS (VALUES (1), (2)) " +
+		"SELECT n * 0.5, CASE n WHEN 2 THEN printf('%.*c', 100000, 'x') ELSE '' END FROM t")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer stmt.Finalize()
+	for row := 0; row < 2; row++ {
+		if !stmt.FetchBatch(1, &b) {
+			t.Fatal(stmt.Finalize())
+		}
+		f := float64(row+1) * 0.5
+		if got := b.ColumnType(0, 0); got != ColumnTypeFloat {
+			t.Errorf("row %d: got type %v, want float", row, got)
+		}
+		if got := b.ColumnDouble(0, 0); got != f {
+			t.Errorf("row %d: got %v, want %v", row, got, f)
+		}
+		if got, want := b.ColumnText(0, 0), []string{"0.5", "1.0"}[row]; got != want {
+			t.Errorf("row %d: got %q, want %q", row, got, want)
+		}
+	}
+}
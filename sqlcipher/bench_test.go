@@ -0,0 +1,270 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package sqlcipher
+
+import (
+	"crypto/sha1"
+	"crypto/sha256"
+	"crypto/sha512"
+	"fmt"
+	"hash"
+	"path/filepath"
+	"strings"
+	"testing"
+)
+
+const (
+	benchRows     = 1000
+	benchPageSize = 4096
+)
+
+// A raw key, so that no key derivation is needed
+var benchKey = []byte("x'" + strings.Repeat("0123456789abcdef", 4) + "'")
+
+// openBenchDB opens a keyed database at path and fills it with benchRows
+// rows. The database is closed when the benchmark finishes.
+func openBenchDB(b *testing.B, path string) *DB {
+	b.Helper()
+
+	db, err := Open(path)
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.Cleanup(func() { db.Close() })
+
+	if err := db.Key(benchKey); err != nil {
+		b.Fatal(err)
+	}
+
+	err = db.Execf("CREATE TABLE t (i INTEGER, s TEXT); "+
+		"WITH RECURSIVE n(i) AS (SELECT 1 UNION ALL SELECT i + 1 FROM n WHERE i < %d) "+
+		"INSERT INTO t SELECT i, printf('%%064d', i) FROM n", benchRows)
+	if err != nil {
+		b.Fatal(err)
+	}
+
+	return db
+}
+
+// prepareBenchStmt prepares a statement that selects the rows of the
+// benchmark database
+func prepareBenchStmt(b *testing.B, db *DB) *Stmt {
+	b.Helper()
+	stmt, _, err := db.Prepare("SELECT i, s FROM t")
+	if err != nil {
+		b.Fatal(err)
+	}
+	b.Cleanup(func() { stmt.Finalize() })
+	return stmt
+}
+
+// stepBenchStmt steps stmt, starting over after the last row
+func stepBenchStmt(b *testing.B, stmt *Stmt) {
+	if stmt.Step() {
+		return
+	}
+	if err := stmt.Reset(); err != nil {
+		b.Fatal(err)
+	}
+	if !stmt.Step() {
+		b.Fatal("no rows")
+	}
+}
+
+func BenchmarkStep(b *testing.B) {
+	stmt := prepareBenchStmt(b, openBenchDB(b, ":memory:"))
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		stepBenchStmt(b, stmt)
+	}
+}
+
+// BenchmarkFetchBatch fetches the same rows as BenchmarkStep and reads every
+// column, so the time per row can be compared with that of BenchmarkRow
+func BenchmarkFetchBatch(b *testing.B) {
+	stmt := prepareBenchStmt(b, openBenchDB(b, ":memory:"))
+	var batch Batch
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; {
+		if !stmt.FetchBatch(64, &batch) {
+			if err := stmt.Reset(); err != nil {
+				b.Fatal(err)
+			}
+			batch.Reset()
+			continue
+		}
+		for row := 0; row < batch.Len() && i < b.N; row++ {
+			batch.ColumnInt64(row, 0)
+			batch.ColumnText(row, 1)
+			i++
+		}
+	}
+}
+
+// BenchmarkRow steps and reads every column of a row
+func BenchmarkRow(b *testing.B) {
+	stmt := prepareBenchStmt(b, openBenchDB(b, ":memory:"))
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		stepBenchStmt(b, stmt)
+		stmt.ColumnInt64(0)
+		stmt.ColumnText(1)
+	}
+}
+
+func BenchmarkColumnType(b *testing.B) {
+	stmt := prepareBenchStmt(b, openBenchDB(b, ":memory:"))
+	stepBenchStmt(b, stmt)
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if stmt.ColumnType(1) != ColumnTypeText {
+			b.Fatal("unexpected column type")
+		}
+	}
+}
+
+func BenchmarkColumnInt64(b *testing.B) {
+	stmt := prepareBenchStmt(b, openBenchDB(b, ":memory:"))
+	stepBenchStmt(b, stmt)
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		if stmt.ColumnInt64(0) != 1 {
+			b.Fatal("unexpected column value")
+		}
+	}
+}
+
+func BenchmarkColumnText(b *testing.B) {
+	stmt := prepareBenchStmt(b, openBenchDB(b, ":memory:"))
+	stepBenchStmt(b, stmt)
+	b.SetBytes(int64(len(stmt.ColumnText(1))))
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		stmt.ColumnText(1)
+	}
+}
+
+func BenchmarkBindText(b *testing.B) {
+	benchmarkBind(b, (*Stmt).BindText)
+}
+
+func BenchmarkBindBlob(b *testing.B) {
+	benchmarkBind(b, func(s *Stmt, idx int, val string) error {
+		return s.BindBlob(idx, []byte(val))
+	})
+}
+
+func benchmarkBind(b *testing.B, bind func(*Stmt, int, string) error) {
+	db := openBenchDB(b, ":memory:")
+	for _, size := range []int{16, 1024} {
+		b.Run(fmt.Sprint(size), func(b *testing.B) {
+			stmt, _, err := db.Prepare("SELECT ?")
+			if err != nil {
+				b.Fatal(err)
+			}
+			defer stmt.Finalize()
+
+			val := strings.Repeat("x", size)
+			b.SetBytes(int64(size))
+			b.ReportAllocs()
+			b.ResetTimer()
+			for i := 0; i < b.N; i++ {
+				if err := bind(stmt, 1, val); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+// BenchmarkReadPages measures reading a keyed database from disk. Every page
+// passes through the crypto callbacks.
+func BenchmarkReadPages(b *testing.B) {
+	db := openBenchDB(b, filepath.Join(b.TempDir(), "db.sqlite"))
+
+	// Keep the page cache small so that pages are read and decrypted
+	// again on every scan
+	if err := db.Exec("PRAGMA cache_size = 1"); err != nil {
+		b.Fatal(err)
+	}
+	stmt := prepareBenchStmt(b, db)
+
+	b.ReportAllocs()
+	b.ResetTimer()
+	for i := 0; i < b.N; i++ {
+		for stmt.Step() {
+			stmt.ColumnInt64(0)
+		}
+		if err := stmt.Reset(); err != nil {
+			b.Fatal(err)
+		}
+	}
+}
+
+func BenchmarkCipher(b *testing.B) {
+	key := make([]byte, cipherKeySize)
+	iv := make([]byte, cipherIVSize)
+	in := make([]byte, benchPageSize)
+	out := make([]byte, benchPageSize)
+
+	for _, encrypt := range []bool{false, true} {
+		name := "decrypt"
+		if encrypt {
+			name = "encrypt"
+		}
+		b.Run(name, func(b *testing.B) {
+			b.SetBytes(benchPageSize)
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				if err := cryptBlocks(key, iv, in, out, encrypt); err != nil {
+					b.Fatal(err)
+				}
+			}
+		})
+	}
+}
+
+func BenchmarkHMAC(b *testing.B) {
+	hashes := []struct {
+		name string
+		h    func() hash.Hash
+		size int
+	}{
+		{"sha1", sha1.New, sha1.Size},
+		{"sha256", sha256.New, sha256.Size},
+		{"sha512", sha512.New, sha512.Size},
+	}
+
+	key := make([]byte, cipherKeySize)
+	in := make([]byte, benchPageSize)
+	in2 := make([]byte, 4)
+
+	for _, h := range hashes {
+		b.Run(h.name, func(b *testing.B) {
+			out := make([]byte, h.size)
+			b.SetBytes(benchPageSize)
+			b.ReportAllocs()
+			for i := 0; i < b.N; i++ {
+				computeHMAC(h.h, key, in, in2, out)
+			}
+		})
+	}
+}
@@ -0,0 +1,81 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package sqlcipher
+
+import (
+	"bytes"
+	"testing"
+)
+
+func TestBind(t *testing.T) {
+	db, err := Open(":memory:")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer db.Close()
+
+	stmt, _, err := db.Prepare("SELECT ?, typeof(?), ?, typeof(?)")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer stmt.Finalize()
+
+	texts := []string{"", "a", "a\x00b", string(make([]byte, 10000))}
+	blobs := [][]byte{nil, {1}, {0, 1, 2}, make([]byte, 10000)}
+
+	for i := range texts {
+		err = stmt.BindText(1, texts[i])
+		if err == nil {
+			err = stmt.BindText(2, texts[i])
+		}
+		if err == nil {
+			err = stmt.BindBlob(3, blobs[i])
+		}
+		if err == nil {
+			err = stmt.BindBlob(4, blobs[i])
+		}
+		if err != nil {
+			t.Fatal(err)
+		}
+
+		if !stmt.Step() {
+			t.Fatal("no rows")
+		}
+		if got := stmt.ColumnText(0); got != texts[i] {
+			t.Errorf("got text %q, want %q", got, texts[i])
+		}
+		if got := stmt.ColumnText(1); got != "text" {
+			t.Errorf("got text of type %s", got)
+		}
+		// Empty blobs are bound as NULL
+		want := "null"
+		if len(blobs[i]) > 0 {
+			want = "blob"
+			if got := stmt.ColumnBlob(2); !bytes.Equal(got, blobs[i]) {
+				t.Errorf("got blob %v, want %v", got, blobs[i])
+			}
+		}
+		if got := stmt.ColumnText(3); got != want {
+			t.Errorf("got blob of type %s, want %s", got, want)
+		}
+		if err := stmt.Reset(); err != nil {
+			t.Fatal(err)
+		}
+	}
+
+	if err := stmt.BindText(5, "x"); err == nil {
+		t.Error("binding nonexistent parameter succeeded")
+	}
+}
@@ -27,6 +27,7 @@ import (
 	"crypto/sha1"
 	"crypto/sha256"
 	"crypto/sha512"
+	"errors"
 	"hash"
 	"unsafe"
 
@@ -101,37 +102,42 @@ func sqlcipherGoRandom(buf unsafe.Pointer, bufSize C.int) C.int {
 
 //export sqlcipherGoHMACSHA1
 func sqlcipherGoHMACSHA1(key *C.uchar, keySize C.int, in *C.uchar, inSize C.int, in2 *C.uchar, in2Size C.int, out *C.uchar) C.int {
-	return sqlcipherGoHMAC(sha1.New, key, keySize, in, inSize, in2, in2Size, out)
+	return sqlcipherGoHMAC(sha1.New, sha1.Size, key, keySize, in, inSize, in2, in2Size, out)
 }
 
 //export sqlcipherGoHMACSHA256
 func sqlcipherGoHMACSHA256(key *C.uchar, keySize C.int, in *C.uchar, inSize C.int, in2 *C.uchar, in2Size C.int, out *C.uchar) C.int {
-	return sqlcipherGoHMAC(sha256.New, key, keySize, in, inSize, in2, in2Size, out)
+	return sqlcipherGoHMAC(sha256.New, sha256.Size, key, keySize, in, inSize, in2, in2Size, out)
 }
 
 //export sqlcipherGoHMACSHA512
 func sqlcipherGoHMACSHA512(key *C.uchar, keySize C.int, in *C.uchar, inSize C.int, in2 *C.uchar, in2Size C.int, out *C.uchar) C.int {
-	return sqlcipherGoHMAC(sha512.New, key, keySize, in, inSize, in2, in2Size, out)
+	return sqlcipherGoHMAC(sha512.New, sha512.Size, key, keySize, in, inSize, in2, in2Size, out)
 }
 
-func sqlcipherGoHMAC(h func() hash.Hash, key *C.uchar, keySize C.int, in *C.uchar, inSize C.int, in2 *C.uchar, in2Size C.int, out *C.uchar) C.int {
+func sqlcipherGoHMAC(h func() hash.Hash, size int, key *C.uchar, keySize C.int, in *C.uchar, inSize C.int, in2 *C.uchar, in2Size C.int, out *C.uchar) C.int {
 	keySlice := unsafe.Slice((*byte)(key), keySize)
-	hmac := hmac.New(h, keySlice)
-
 	inSlice := unsafe.Slice((*byte)(in), inSize)
-	hmac.Write(inSlice)
 
+	var in2Slice []byte
 	if unsafe.Pointer(in2) != C.NULL {
-		in2Slice := unsafe.Slice((*byte)(in2), in2Size)
-		hmac.Write(in2Slice)
+		in2Slice = unsafe.Slice((*byte)(in2), in2Size)
 	}
 
-	outSlice := unsafe.Slice((*byte)(out), hmac.Size())
-	copy(outSlice, hmac.Sum(nil))
+	outSlice := unsafe.Slice((*byte)(out), size)
+	computeHMAC(h, keySlice, inSlice, in2Slice, outSlice)
 
 	return C.SQLITE_OK
 }
 
+// computeHMAC computes the HMAC of in and in2 and stores it in out
+func computeHMAC(h func() hash.Hash, key, in, in2, out []byte) {
+	hmac := hmac.New(h, key)
+	hmac.Write(in)
+	hmac.Write(in2)
+	hmac.Sum(out[:0])
+}
+
 //export sqlcipherGoKDFSHA1
 func sqlcipherGoKDFSHA1(pass *C.uchar, passSize C.int, salt *C.uchar, saltSize C.int, iter C.int, key *C.uchar, keySize C.int) C.int {
 	return sqlcipherGoKDF(sha1.New, pass, passSize, salt, saltSize, iter, key, keySize)
@@ -160,29 +166,38 @@ func sqlcipherGoKDF(h func() hash.Hash, pass *C.uchar, passSize C.int, salt *C.u
 
 //export sqlcipherGoCipher
 func sqlcipherGoCipher(key *C.uchar, keySize C.int, iv *C.uchar, in *C.uchar, inSize C.int, out *C.uchar, encrypt C.int) C.int {
-	if keySize != cipherKeySize {
+	keySlice := unsafe.Slice((*byte)(key), keySize)
+	ivSlice := unsafe.Slice((*byte)(iv), cipherIVSize)
+	inSlice := unsafe.Slice((*byte)(in), inSize)
+	outSlice := unsafe.Slice((*byte)(out), inSize)
+
+	if err := cryptBlocks(keySlice, ivSlice, inSlice, outSlice, encrypt != 0); err != nil {
 		return C.SQLITE_ERROR
 	}
 
-	keySlice := unsafe.Slice((*byte)(key), keySize)
-	aesCipher, err := aes.NewCipher(keySlice)
+	return C.SQLITE_OK
+}
+
+// cryptBlocks encrypts or decrypts in and stores the result in out
+func cryptBlocks(key, iv, in, out []byte, encrypt bool) error {
+	if len(key) != cipherKeySize {
+		return errors.New("invalid key size")
+	}
+
+	aesCipher, err := aes.NewCipher(key)
 	if err != nil {
-		return C.SQLITE_ERROR
+		return err
 	}
 
-	ivSlice := unsafe.Slice((*byte)(iv), cipherIVSize)
 	var cbcCipher cipher.BlockMode
-	if encrypt != 0 {
-		cbcCipher = cipher.NewCBCEncrypter(aesCipher, ivSlice)
+	if encrypt {
+		cbcCipher = cipher.NewCBCEncrypter(aesCipher, iv)
 	} else {
-		cbcCipher = cipher.NewCBCDecrypter(aesCipher, ivSlice)
+		cbcCipher = cipher.NewCBCDecrypter(aesCipher, iv)
 	}
 
-	inSlice := unsafe.Slice((*byte)(in), inSize)
-	outSlice := unsafe.Slice((*byte)(out), inSize)
-	cbcCipher.CryptBlocks(outSlice, inSlice)
-
-	return C.SQLITE_OK
+	cbcCipher.CryptBlocks(out, in)
+	return nil
 }
 
 //export sqlcipherGoGetCipher
@@ -0,0 +1,182 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package sqlcipher
+
+import (
+	"fmt"
+	"reflect"
+	"strings"
+	"unsafe"
+)
+
+// Number of rows fetched per call to FetchBatch
+const rowsBatchSize = 64
+
+// NullString is a text value that may be NULL
+type NullString struct {
+	String string
+	Valid  bool
+}
+
+// NullInt64 is an integer value that may be NULL
+type NullInt64 struct {
+	Int64 int64
+	Valid bool
+}
+
+// NullFloat64 is a floating-point value that may be NULL
+type NullFloat64 struct {
+	Float64 float64
+	Valid   bool
+}
+
+type fieldKind int
+
+const (
+	fieldString fieldKind = iota
+	fieldInt64
+	fieldInt
+	fieldFloat64
+	fieldBytes
+	fieldNullString
+	fieldNullInt64
+	fieldNullFloat64
+)
+
+var fieldKinds = map[reflect.Type]fieldKind{
+	reflect.TypeOf(""):            fieldString,
+	reflect.TypeOf(int64(0)):      fieldInt64,
+	reflect.TypeOf(0):             fieldInt,
+	reflect.TypeOf(float64(0)):    fieldFloat64,
+	reflect.TypeOf([]byte(nil)):   fieldBytes,
+	reflect.TypeOf(NullString{}):  fieldNullString,
+	reflect.TypeOf(NullInt64{}):   fieldNullInt64,
+	reflect.TypeOf(NullFloat64{}): fieldNullFloat64,
+}
+
+// fieldPlan describes how a column is stored in a struct field
+type fieldPlan struct {
+	col    int
+	offset uintptr
+	kind   fieldKind
+}
+
+// Rows decodes the rows of a statement into structs of type T. The fields
+// of T that have an "sql" tag receive the value of the column with that
+// name. NULL values become zero values, unless the field has one of the Null
+// types.
+//
+// The mapping from columns to fields is resolved once, when Rows is created,
+// so decoding a row involves no reflection. Rows are fetched in batches with
+// FetchBatch.
+type Rows[T any] struct {
+	stmt   *Stmt
+	fields []fieldPlan
+	batch  Batch
+	row    int
+}
+
+// Scan returns a Rows that decodes the rows of s into structs of type T. It
+// returns an error if T is not a struct, if a tagged field has an unsupported
+// type or if s has no column for a tagged field.
+func Scan[T any](s *Stmt) (*Rows[T], error) {
+	t := reflect.TypeOf((*T)(nil)).Elem()
+	if t.Kind() != reflect.Struct {
+		return nil, fmt.Errorf("cannot scan rows into %v: not a struct", t)
+	}
+
+	cols := make([]string, s.ColumnCount())
+	for i := range cols {
+		cols[i] = s.ColumnName(i)
+	}
+
+	var fields []fieldPlan
+	for i := 0; i < t.NumField(); i++ {
+		f := t.Field(i)
+		name, ok := f.Tag.Lookup("sql")
+		if !ok {
+			continue
+		}
+		kind, ok := fieldKinds[f.Type]
+		if !ok {
+			return nil, fmt.Errorf("cannot scan column %q into field %s of type %v", name, f.Name, f.Type)
+		}
+		col := columnIndex(cols, name)
+		if col < 0 {
+			return nil, fmt.Errorf("no column %q for field %s", name, f.Name)
+		}
+		fields = append(fields, fieldPlan{col: col, offset: f.Offset, kind: kind})
+	}
+
+	return &Rows[T]{stmt: s, fields: fields, row: -1}, nil
+}
+
+func columnIndex(cols []string, name string) int {
+	for i, col := range cols {
+		// Column names are case-insensitive in SQLite
+		if strings.EqualFold(col, name) {
+			return i
+		}
+	}
+	return -1
+}
+
+// Next advances to the next row. It returns false if there are no more rows
+// or if an error occurred. The error is returned by Finalize or Reset of the
+// statement.
+func (r *Rows[T]) Next() bool {
+	r.row++
+	if r.row < r.batch.Len() {
+		return true
+	}
+	r.row = 0
+	return r.stmt.FetchBatch(rowsBatchSize, &r.batch)
+}
+
+// Scan decodes the current row into v
+func (r *Rows[T]) Scan(v *T) {
+	b, row, base := &r.batch, r.row, unsafe.Pointer(v)
+	for _, f := range r.fields {
+		p := unsafe.Add(base, f.offset)
+		switch f.kind {
+		case fieldString:
+			*(*string)(p) = b.ColumnText(row, f.col)
+		case fieldInt64:
+			*(*int64)(p) = b.ColumnInt64(row, f.col)
+		case fieldInt:
+			*(*int)(p) = b.ColumnInt(row, f.col)
+		case fieldFloat64:
+			*(*float64)(p) = b.ColumnDouble(row, f.col)
+		case fieldBytes:
+			*(*[]byte)(p) = b.ColumnBlob(row, f.col)
+		case fieldNullString:
+			valid := b.ColumnType(row, f.col) != ColumnTypeNull
+			*(*NullString)(p) = NullString{String: b.ColumnText(row, f.col), Valid: valid}
+		case fieldNullInt64:
+			valid := b.ColumnType(row, f.col) != ColumnTypeNull
+			*(*NullInt64)(p) = NullInt64{Int64: b.ColumnInt64(row, f.col), Valid: valid}
+		case fieldNullFloat64:
+			valid := b.ColumnType(row, f.col) != ColumnTypeNull
+			*(*NullFloat64)(p) = NullFloat64{Float64: b.ColumnDouble(row, f.col), Valid: valid}
+		}
+	}
+}
+
+// Row returns the current row
+func (r *Rows[T]) Row() T {
+	var v T
+	r.Scan(&v)
+	return v
+}
@@ -0,0 +1,87 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package sqlcipher
+
+import (
+	"reflect"
+	"testing"
+)
+
+func TestScan(t *testing.T) {
+	db, err := Open(":memory:")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer db.Close()
+
+	stmt, _, err := db.Prepare("SELECT 1 AS i, 2.5 AS f, 'x' AS s, x'0102' AS b, NULL AS n, 'y' AS ns, 3 AS ni, NULL AS nf, 'z' AS unused " +
+		"UNION ALL SELECT NULL, NULL, NULL, NULL, NULL, NULL, NULL, 4.5, NULL")
+	if err != nil {
+		t.Fatal(err)
+	}
+	defer stmt.Finalize()
+
+	type row struct {
+		I        int64       `sql:"i"`
+		F        float64     `sql:"F"`
+		S        string      `sql:"s"`
+		B        []byte      `sql:"b"`
+		N        int         `sql:"n"`
+		NS       NullString  `sql:"ns"`
+		NI       NullInt64   `sql:"ni"`
+		NF       NullFloat64 `sql:"nf"`
+		Untagged string
+	}
+
+	rows, err := Scan[row](stmt)
+	if err != nil {
+		t.Fatal(err)
+	}
+
+	var got []row
+	for rows.Next() {
+		got = append(got, rows.Row())
+	}
+	if err := stmt.Reset(); err != nil {
+		t.Fatal(err)
+	}
+
+	want := []row{
+		{I: 1, F: 2.5, S: "x", B: []byte{1, 2}, NS: NullString{"y", true}, NI: NullInt64{3, true}},
+		{NF: NullFloat64{4.5, true}},
+	}
+	if len(got) != len(want) {
+		t.Fatalf("got %d rows, want %d", len(got), len(want))
+	}
+	for i := range want {
+		if !reflect.DeepEqual(got[i], want[i]) {
+			t.Errorf("row %d: got %+v, want %+v", i, got[i], want[i])
+		}
+	}
+
+	if _, err := Scan[struct {
+		X string `sql:"x"`
+	}](stmt); err == nil {
+		t.Error("scanning into field without column succeeded")
+	}
+	if _, err := Scan[struct {
+		I uint8 `sql:"i"`
+	}](stmt); err == nil {
+		t.Error("scanning into field of unsupported type succeeded")
+	}
+	if _, err := Scan[int](stmt); err == nil {
+		t.Error("scanning into non-struct succeeded")
+	}
+}
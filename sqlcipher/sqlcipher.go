@@ -21,13 +21,32 @@ package sqlcipher
 //
 // #include "sqlite3.h"
 //
-// typedef void (*bind_destructor)(void *);
 // typedef int (*exec_callback)(void *, int, char **, char **);
+//
+// static int
+// sqlcipher_bind_text(sqlite3_stmt *stmt, int idx, _GoString_ val)
+// {
+// 	const char *p;
+//
+// 	/* A null pointer would bind NULL instead of an empty string */
+// 	if ((p = _GoStringPtr(val)) == NULL)
+// 		p = "";
+// 	return sqlite3_bind_text64(stmt, idx, p, _GoStringLen(val),
+// 	    SQLITE_TRANSIENT, SQLITE_UTF8);
+// }
+//
+// static int
+// sqlcipher_bind_blob(sqlite3_stmt *stmt, int idx, const void *val,
+//     sqlite3_uint64 len)
+// {
+// 	return sqlite3_bind_blob64(stmt, idx, val, len, SQLITE_TRANSIENT);
+// }
 import "C"
 
 import (
 	"errors"
 	"fmt"
+	"time"
 	"unsafe"
 )
 
@@ -82,6 +101,15 @@ func (db *DB) Close() error {
 	return nil
 }
 
+// BusyTimeout makes statements wait up to d for a lock on the database before
+// they fail
+func (db *DB) BusyTimeout(d time.Duration) error {
+	if C.sqlite3_busy_timeout(db.db, C.int(d.Milliseconds())) != C.SQLITE_OK {
+		return db.errorf("cannot set busy timeout")
+	}
+	return nil
+}
+
 func (db *DB) Key(key []byte) error {
 	if C.sqlite3_key(db.db, unsafe.Pointer(&key[0]), C.int(len(key))) != C.SQLITE_OK {
 		return db.errorf("cannot set key")
@@ -144,6 +172,13 @@ type Stmt struct {
 	err  error
 }
 
+// Complete reports whether sql ends with a complete SQL statement
+func Complete(sql string) bool {
+	sqlCS := C.CString(sql)
+	defer C.free(unsafe.Pointer(sqlCS))
+	return C.sqlite3_complete(sqlCS) != 0
+}
+
 func (db *DB) Prepare(sql string) (*Stmt, string, error) {
 	sqlCS := C.CString(sql)
 	defer C.free(unsafe.Pointer(sqlCS))
@@ -207,20 +242,22 @@ func (s *Stmt) BindDouble(idx int, val float64) error {
 	return nil
 }
 
+// BindText binds a text parameter. SQLite makes its own copy of val.
 func (s *Stmt) BindText(idx int, val string) error {
-	valCS := C.CString(val)
-	if C.sqlite3_bind_text(s.stmt, C.int(idx), valCS, -1, C.bind_destructor(C.free)) != C.SQLITE_OK {
+	if C.sqlcipher_bind_text(s.stmt, C.int(idx), val) != C.SQLITE_OK {
 		return s.db.errorf("cannot bind text parameter")
 	}
 	return nil
 }
 
+// BindBlob binds a blob parameter. SQLite makes its own copy of val. An empty
+// blob is bound as NULL.
 func (s *Stmt) BindBlob(idx int, val []byte) error {
-	valCB := C.NULL
+	var valp unsafe.Pointer
 	if len(val) > 0 {
-		valCB = C.CBytes(val)
+		valp = unsafe.Pointer(&val[0])
 	}
-	if C.sqlite3_bind_blob(s.stmt, C.int(idx), valCB, C.int(len(val)), C.bind_destructor(C.free)) != C.SQLITE_OK {
+	if C.sqlcipher_bind_blob(s.stmt, C.int(idx), valp, C.sqlite3_uint64(len(val))) != C.SQLITE_OK {
 		return s.db.errorf("cannot bind blob parameter")
 	}
 	return nil
@@ -250,6 +287,19 @@ func (s *Stmt) Finalize() error {
 	return nil
 }
 
+func (s *Stmt) Reset() error {
+	ret := C.sqlite3_reset(s.stmt)
+	if s.err != nil {
+		err := s.err
+		s.err = nil
+		return err
+	}
+	if ret != C.SQLITE_OK {
+		return s.db.errorf("cannot reset SQL statement")
+	}
+	return nil
+}
+
 type ColumnType int
 
 const (
@@ -340,6 +390,16 @@ func (s *Stmt) ColumnCount() int {
 	return int(C.sqlite3_column_count(s.stmt))
 }
 
+func (s *Stmt) ColumnName(idx int) string {
+	name := C.sqlite3_column_name(s.stmt, C.int(idx))
+	if name == nil {
+		// sqlite3_column_name() only returns NULL if a memory
+		// allocation fails
+		panic("sqlite: cannot get column name")
+	}
+	return C.GoString(name)
+}
+
 type Backup struct {
 	db     *DB
 	backup *C.sqlite3_backup
@@ -0,0 +1,132 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+package sqlcipher
+
+// #include "sqlite3.h"
+//
+// extern int sqlcipherGoTrace(unsigned int, void *, void *, void *);
+import "C"
+
+import (
+	"sync"
+	"time"
+	"unsafe"
+)
+
+// TraceInfo contains information about an executed statement
+type TraceInfo struct {
+	SQL           string
+	Duration      time.Duration
+	Rows          int
+	FullscanSteps int
+	Sorts         int
+	AutoIndexes   int
+	VMSteps       int
+}
+
+type traceState struct {
+	fn    func(*TraceInfo)
+	start map[*C.sqlite3_stmt]time.Time
+	rows  map[*C.sqlite3_stmt]int
+}
+
+var (
+	traceMu     sync.Mutex
+	traceStates = make(map[*C.sqlite3]*traceState)
+)
+
+// Trace arranges for fn to be called every time a statement has finished
+// executing. Tracing is disabled if fn is nil.
+func (db *DB) Trace(fn func(*TraceInfo)) error {
+	traceMu.Lock()
+	defer traceMu.Unlock()
+
+	if fn == nil {
+		delete(traceStates, db.db)
+		if C.sqlite3_trace_v2(db.db, 0, nil, nil) != C.SQLITE_OK {
+			return db.errorf("cannot disable tracing")
+		}
+		return nil
+	}
+
+	traceStates[db.db] = &traceState{
+		fn:    fn,
+		start: make(map[*C.sqlite3_stmt]time.Time),
+		rows:  make(map[*C.sqlite3_stmt]int),
+	}
+	mask := C.uint(C.SQLITE_TRACE_STMT | C.SQLITE_TRACE_PROFILE | C.SQLITE_TRACE_ROW | C.SQLITE_TRACE_CLOSE)
+	if C.sqlite3_trace_v2(db.db, mask, (*[0]byte)(C.sqlcipherGoTrace), nil) != C.SQLITE_OK {
+		delete(traceStates, db.db)
+		return db.errorf("cannot enable tracing")
+	}
+	return nil
+}
+
+//export sqlcipherGoTrace
+func sqlcipherGoTrace(mask C.uint, _ unsafe.Pointer, p unsafe.Pointer, x unsafe.Pointer) C.int {
+	if mask == C.SQLITE_TRACE_CLOSE {
+		traceMu.Lock()
+		delete(traceStates, (*C.sqlite3)(p))
+		traceMu.Unlock()
+		return 0
+	}
+
+	stmt := (*C.sqlite3_stmt)(p)
+	traceMu.Lock()
+	ts := traceStates[C.sqlite3_db_handle(stmt)]
+	traceMu.Unlock()
+	if ts == nil {
+		return 0
+	}
+
+	switch mask {
+	case C.SQLITE_TRACE_STMT:
+		// This is also called for triggers, so only record the
+		// first call
+		if _, ok := ts.start[stmt]; !ok {
+			ts.start[stmt] = time.Now()
+		}
+	case C.SQLITE_TRACE_ROW:
+		ts.rows[stmt]++
+	case C.SQLITE_TRACE_PROFILE:
+		// The duration measured by SQLite has a resolution of only a
+		// millisecond on most systems, so use our own measurement if
+		// there is one
+		d := time.Duration(*(*C.sqlite3_int64)(x))
+		if start, ok := ts.start[stmt]; ok {
+			d = time.Since(start)
+		}
+		info := TraceInfo{
+			SQL:           C.GoString(C.sqlite3_sql(stmt)),
+			Duration:      d,
+			Rows:          ts.rows[stmt],
+			FullscanSteps: stmtStatus(stmt, C.SQLITE_STMTSTATUS_FULLSCAN_STEP),
+			Sorts:         stmtStatus(stmt, C.SQLITE_STMTSTATUS_SORT),
+			AutoIndexes:   stmtStatus(stmt, C.SQLITE_STMTSTATUS_AUTOINDEX),
+			VMSteps:       stmtStatus(stmt, C.SQLITE_STMTSTATUS_VM_STEP),
+		}
+		delete(ts.start, stmt)
+		delete(ts.rows, stmt)
+		ts.fn(&info)
+	}
+
+	return 0
+}
+
+// stmtStatus returns and resets a statement counter, so that the counters of a
+// reused statement only cover its latest execution
+func stmtStatus(stmt *C.sqlite3_stmt, op C.int) int {
+	return int(C.sqlite3_stmt_status(stmt, op, 1))
+}
@@ -0,0 +1,226 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+// Package stats records where time is spent during an export. Elapsed time is
+// charged to the current stage of the export; entering a stage suspends the
+// previous one until the stage is left. Stages are entered and left for every
+// message, so CPU time is not broken down by stage; the CPU time used by the
+// whole export is sampled when the statistics are written. All methods may be
+// called on a nil *Stats, in which case they do nothing.
+package stats
+
+import (
+	"encoding/json"
+	"fmt"
+	"io"
+	"text/tabwriter"
+	"time"
+)
+
+type Stage int
+
+const (
+	Other Stage = iota
+	SQL
+	JSON
+	Recipients
+	Mentions
+	Format
+	Write
+	Copy
+	numStages
+)
+
+var stageNames = [numStages]string{
+	Other:      "other",
+	SQL:        "sql",
+	JSON:       "json",
+	Recipients: "recipients",
+	Mentions:   "mentions",
+	Format:     "format",
+	Write:      "write",
+	Copy:       "copy",
+}
+
+func (s Stage) String() string {
+	return stageNames[s]
+}
+
+type Stats struct {
+	cur         Stage
+	start       time.Time
+	last        time.Time
+	startCPU    time.Duration
+	cpu         time.Duration
+	wall        [numStages]time.Duration
+	messages    int64
+	attachments int64
+	bytes       int64
+}
+
+func New() *Stats {
+	now := time.Now()
+	return &Stats{
+		start:    now,
+		last:     now,
+		startCPU: cpuTime(),
+	}
+}
+
+// Enter makes stage the current stage. It returns the previous stage, which
+// should be passed to Leave.
+func (s *Stats) Enter(stage Stage) Stage {
+	if s == nil {
+		return Other
+	}
+	s.charge()
+	prev := s.cur
+	s.cur = stage
+	return prev
+}
+
+// Leave makes prev the current stage again
+func (s *Stats) Leave(prev Stage) {
+	s.Enter(prev)
+}
+
+// charge charges the time since the last stage change to the current stage
+func (s *Stats) charge() {
+	now := time.Now()
+	s.wall[s.cur] += now.Sub(s.last)
+	s.last = now
+}
+
+// finish charges the time spent in the current stage and samples the CPU time
+// used since New was called
+func (s *Stats) finish() {
+	s.charge()
+	s.cpu = cpuTime() - s.startCPU
+}
+
+func (s *Stats) AddMessages(n int) {
+	if s != nil {
+		s.messages += int64(n)
+	}
+}
+
+func (s *Stats) AddAttachments(n int) {
+	if s != nil {
+		s.attachments += int64(n)
+	}
+}
+
+func (s *Stats) AddBytes(n int64) {
+	if s != nil {
+		s.bytes += n
+	}
+}
+
+type writer struct {
+	s *Stats
+	w io.Writer
+}
+
+// Writer returns a writer that writes to w, charges the writes to the Write
+// stage and counts the bytes written
+func (s *Stats) Writer(w io.Writer) io.Writer {
+	if s == nil {
+		return w
+	}
+	return &writer{s, w}
+}
+
+func (w *writer) Write(p []byte) (int, error) {
+	defer w.s.Leave(w.s.Enter(Write))
+	n, err := w.w.Write(p)
+	w.s.bytes += int64(n)
+	return n, err
+}
+
+// WriteTable writes a human-readable summary to w
+func (s *Stats) WriteTable(w io.Writer) error {
+	if s == nil {
+		return nil
+	}
+	s.finish()
+
+	total := s.last.Sub(s.start)
+
+	tw := tabwriter.NewWriter(w, 0, 8, 2, ' ', 0)
+	fmt.Fprintln(tw, "stage\twall\tcpu\twall %")
+	for stage := Other; stage < numStages; stage++ {
+		if s.wall[stage] == 0 {
+			continue
+		}
+		fmt.Fprintf(tw, "%s\t%v\t\t%.1f\n", stage, round(s.wall[stage]), percent(s.wall[stage], total))
+	}
+	fmt.Fprintf(tw, "total\t%v\t%v\t%.1f\n", round(total), round(s.cpu), 100.0)
+	if err := tw.Flush(); err != nil {
+		return err
+	}
+
+	secs := total.Seconds()
+	_, err := fmt.Fprintf(w, "%d messages (%.0f/s), %d attachments (%.0f/s), %d bytes (%.1f MB/s)\n",
+		s.messages, float64(s.messages)/secs,
+		s.attachments, float64(s.attachments)/secs,
+		s.bytes, float64(s.bytes)/secs/1e6)
+	return err
+}
+
+// WriteJSON writes the statistics to w as a JSON object. Durations are in
+// nanoseconds.
+func (s *Stats) WriteJSON(w io.Writer) error {
+	if s == nil {
+		return nil
+	}
+	s.finish()
+
+	type stageJSON struct {
+		Wall int64 `json:"wall_ns"`
+	}
+
+	v := struct {
+		Wall        int64                `json:"wall_ns"`
+		CPU         int64                `json:"cpu_ns"`
+		Stages      map[string]stageJSON `json:"stages"`
+		Messages    int64                `json:"messages"`
+		Attachments int64                `json:"attachments"`
+		Bytes       int64                `json:"bytes"`
+	}{
+		Wall:        int64(s.last.Sub(s.start)),
+		CPU:         int64(s.cpu),
+		Stages:      make(map[string]stageJSON),
+		Messages:    s.messages,
+		Attachments: s.attachments,
+		Bytes:       s.bytes,
+	}
+	for stage := Other; stage < numStages; stage++ {
+		v.Stages[stage.String()] = stageJSON{int64(s.wall[stage])}
+	}
+
+	enc := json.NewEncoder(w)
+	enc.SetIndent("", "\t")
+	return enc.Encode(v)
+}
+
+func round(d time.Duration) time.Duration {
+	return d.Round(time.Microsecond)
+}
+
+func percent(d, total time.Duration) float64 {
+	if total == 0 {
+		return 0
+	}
+	return 100 * float64(d) / float64(total)
+}
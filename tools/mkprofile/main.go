@@ -0,0 +1,70 @@
+// Copyright (c) 2024 Tim van der Molen <tim@kariliq.nl>
+//
+// Permission to use, copy, modify, and distribute this software for any
+// purpose with or without fee is hereby granted, provided that the above
+// copyright notice and this permission notice appear in all copies.
+//
+// THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+// WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+// ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+// WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+// ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+// OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+
+// Command mkprofile generates a synthetic Signal Desktop profile for testing
+// and benchmarking sigtop. For example, to generate a profile with about a
+// million messages:
+//
+//	go run ./tools/mkprofile -conversations 100 -messages 10000 profile
+//
+// The profile can then be used with the -d option of sigtop.
+package main
+
+import (
+	"flag"
+	"fmt"
+	"log"
+	"os"
+
+	"github.com/tbvdm/sigtop/signal/signaltest"
+)
+
+func main() {
+	log.SetFlags(0)
+	log.SetPrefix("mkprofile: ")
+
+	cfg := signaltest.DefaultConfig()
+	flag.IntVar(&cfg.Version, "version", cfg.Version, "database `version`")
+	flag.IntVar(&cfg.Conversations, "conversations", cfg.Conversations, "number of conversations")
+	flag.Float64Var(&cfg.GroupRatio, "groups", cfg.GroupRatio, "fraction of conversations that are groups")
+	flag.Float64Var(&cfg.AvatarRatio, "avatars", cfg.AvatarRatio, "fraction of conversations with an avatar")
+	flag.IntVar(&cfg.Messages, "messages", cfg.Messages, "number of messages per conversation")
+	flag.Float64Var(&cfg.AttachmentRatio, "attachments", cfg.AttachmentRatio, "fraction of messages with an attachment")
+	flag.IntVar(&cfg.AttachmentMinSize, "min-size", cfg.AttachmentMinSize, "minimum attachment size in bytes")
+	flag.IntVar(&cfg.AttachmentMaxSize, "max-size", cfg.AttachmentMaxSize, "maximum attachment size in bytes")
+	flag.Float64Var(&cfg.MentionRatio, "mentions", cfg.MentionRatio, "fraction of messages with a mention")
+	flag.Float64Var(&cfg.QuoteRatio, "quotes", cfg.QuoteRatio, "fraction of messages with a quote")
+	flag.Float64Var(&cfg.ReactionRatio, "reactions", cfg.ReactionRatio, "fraction of messages with a reaction")
+	flag.Float64Var(&cfg.EditRatio, "edits", cfg.EditRatio, "fraction of edited messages")
+	flag.Int64Var(&cfg.Seed, "seed", cfg.Seed, "random number generator seed")
+	flag.Usage = func() {
+		fmt.Fprintf(flag.CommandLine.Output(), "usage: mkprofile [option ...] directory\n")
+		flag.PrintDefaults()
+	}
+	flag.Parse()
+
+	if flag.NArg() != 1 {
+		flag.Usage()
+		os.Exit(1)
+	}
+
+	dir := flag.Arg(0)
+	if err := os.Mkdir(dir, 0777); err != nil {
+		log.Fatal(err)
+	}
+
+	if err := signaltest.Generate(dir, cfg); err != nil {
+		log.Fatal(err)
+	}
+}